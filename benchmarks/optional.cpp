@@ -0,0 +1,112 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// Compares the optional backends of the Next() protocol. Build once per backend and compare the timings:
+//
+//   g++ -std=c++17 -O2 -I../include optional.cpp -o optional_linqcpp
+//   g++ -std=c++17 -O2 -I../include -DLINQCPP_OPTIONAL_BOOST optional.cpp -o optional_boost
+//   g++ -std=c++17 -O2 -I../include -DLINQCPP_OPTIONAL_STD optional.cpp -o optional_std
+
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <linqcpp/linqcpp.h>
+
+namespace
+{
+template< class F >
+void Measure( const char* name, F&& f )
+{
+   constexpr int repeat = 50;
+
+   size_t result = 0;
+   auto start = std::chrono::steady_clock::now();
+   for( int i = 0; i < repeat; ++i )
+   {
+      result += f();
+   }
+   auto elapsed = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - start ).count();
+   std::printf( "%-24s %10lld us  (%zu)\n", name, static_cast< long long >( elapsed / repeat ), result );
+}
+
+const char* BackendName()
+{
+#if defined( LINQCPP_OPTIONAL_BOOST )
+   return "boost::optional";
+#elif defined( LINQCPP_OPTIONAL_STD )
+   return "std::optional";
+#else
+   return "linq::d::Optional";
+#endif
+}
+} // namespace
+
+int main()
+{
+   using namespace linq;
+
+   std::vector< int > ints( 1 << 20 );
+   std::iota( ints.begin(), ints.end(), 0 );
+
+   std::vector< std::string > strings;
+   for( int i = 0; i < ( 1 << 16 ); ++i )
+   {
+      strings.push_back( std::to_string( i ) );
+   }
+
+   std::printf( "%s, sizeof( optional< int& > ) = %zu, sizeof( optional< int > ) = %zu\n",
+                BackendName(),
+                sizeof( d::optional< int& > ),
+                sizeof( d::optional< int > ) );
+
+   Measure( "Next() by reference", [ & ]() {
+      size_t sum = 0;
+      auto from = From( ints );
+      auto it = from.mShim.CreateIterator();
+      while( auto m = it.Next() )
+      {
+         sum += *m;
+      }
+      return sum;
+   } );
+
+   Measure( "Where.Select by value", [ & ]() {
+      size_t sum = 0;
+      auto query = From( ints ).Where( []( int m ) { return m % 3 != 0; } ).Select< int >( []( int m ) { return m * 2; } );
+      auto it = query.mShim.CreateIterator();
+      while( auto m = it.Next() )
+      {
+         sum += *m;
+      }
+      return sum;
+   } );
+
+   Measure( "Select string", [ & ]() {
+      size_t sum = 0;
+      auto query = From( strings ).Select< std::string >( []( const std::string& m ) { return m + "!"; } );
+      auto it = query.mShim.CreateIterator();
+      while( auto m = it.Next() )
+      {
+         sum += m->size();
+      }
+      return sum;
+   } );
+
+   Measure( "MaxOrNone", [ & ]() { return static_cast< size_t >( From( ints ).Select< int >( []( int m ) { return m ^ 0x55; } ).MaxOrNone().value() ); } );
+
+   return 0;
+}
@@ -0,0 +1,236 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+
+// A type-erased query that is a value: it copies and moves like the pipeline it holds, and From() takes it back.
+//
+//   AnyEnumerable< int > query = From( vector ).Where( []( int m ) { return m > 10; } );
+//   From( query ).Take( 10 ).ToVector();
+//
+// Pipelines of up to N bytes are kept inline, larger ones go to storage from the allocator.
+
+#include "enumerable.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace linq
+{
+template< class V, size_t N = 64, class A = std::allocator< std::byte > >
+class AnyEnumerable
+{
+   static_assert( N >= sizeof( void* ), "The inline buffer is too small." );
+
+   struct Concept : IEnumerable< V >
+   {
+      virtual Concept* CopyTo( void* buffer, A& a ) const = 0;
+      virtual Concept* MoveTo( void* buffer ) = 0;
+      virtual void Destroy( A& a ) = 0;
+   };
+
+   template< class T >
+   struct Model : d::Enumerable< T, Concept >
+   {
+      using d::Enumerable< T, Concept >::Enumerable;
+
+      Concept* CopyTo( void* buffer, A& a ) const override
+      {
+         return Make< T >( buffer, a, this->mInnerEnumerable );
+      }
+
+      Concept* MoveTo( void* buffer ) override
+      {
+         return new( buffer ) Model( std::move( *this ) );
+      }
+
+      void Destroy( A& a ) override
+      {
+         typename std::allocator_traits< A >::template rebind_alloc< Model > allocator( a );
+         this->~Model();
+         std::allocator_traits< decltype( allocator ) >::deallocate( allocator, this, 1 );
+      }
+   };
+
+   template< class T >
+   static constexpr bool Fits = sizeof( Model< T > ) <= N && alignof( Model< T > ) <= alignof( std::max_align_t ) &&
+                                std::is_nothrow_move_constructible< T >::value;
+
+   template< class T, class X >
+   static Concept* Make( void* buffer, A& a, X&& x )
+   {
+      if constexpr( Fits< T > )
+      {
+         return new( buffer ) Model< T >( std::forward< X >( x ) );
+      }
+      else
+      {
+         typename std::allocator_traits< A >::template rebind_alloc< Model< T > > allocator( a );
+         using Traits = std::allocator_traits< decltype( allocator ) >;
+         auto p = Traits::allocate( allocator, 1 );
+         try
+         {
+            return new( std::addressof( *p ) ) Model< T >( std::forward< X >( x ) );
+         }
+         catch( ... )
+         {
+            Traits::deallocate( allocator, p, 1 );
+            throw;
+         }
+      }
+   }
+
+public:
+   using ValueType = V;
+   using AllocatorType = A;
+
+   template< class T >
+   AnyEnumerable( d::Shim< T > t, const A& a = A() )
+      : mAllocator{ a }
+   {
+      static_assert( std::is_same< typename d::Shim< T >::ValueType, V >::value, "The pipeline yields another type." );
+      static_assert( std::is_copy_constructible< d::Shim< T > >::value, "The pipeline can't be copied." );
+      mConcept = Make< d::Shim< T > >( mBuffer, mAllocator, std::move( t ) );
+   }
+
+   AnyEnumerable( const AnyEnumerable& a )
+      : mAllocator{ std::allocator_traits< A >::select_on_container_copy_construction( a.mAllocator ) }
+   {
+      mConcept = a.mConcept->CopyTo( mBuffer, mAllocator );
+   }
+
+   AnyEnumerable( AnyEnumerable&& a ) noexcept
+      : mAllocator{ a.mAllocator }
+   {
+      Take( std::move( a ) );
+   }
+
+   AnyEnumerable& operator=( const AnyEnumerable& a )
+   {
+      if( this != &a )
+      {
+         *this = AnyEnumerable( a );
+      }
+      return *this;
+   }
+
+   AnyEnumerable& operator=( AnyEnumerable&& a ) noexcept
+   {
+      if( this != &a )
+      {
+         Reset();
+         mAllocator = a.mAllocator;
+         Take( std::move( a ) );
+      }
+      return *this;
+   }
+
+   ~AnyEnumerable()
+   {
+      Reset();
+   }
+
+   const IEnumerable< V >& Get() const
+   {
+      return *mConcept;
+   }
+
+   d::SizeHint GetSizeHint() const
+   {
+      return mConcept->GetSizeHint();
+   }
+
+   A GetAllocator() const
+   {
+      return mAllocator;
+   }
+
+   // Whether the pipeline is kept in the object itself.
+   bool Inline() const
+   {
+      auto p = reinterpret_cast< const unsigned char* >( mConcept );
+      return std::less_equal<>()( mBuffer, p ) && std::less<>()( p, mBuffer + N );
+   }
+
+private:
+   void Take( AnyEnumerable&& a )
+   {
+      if( a.Inline() )
+      {
+         mConcept = a.mConcept->MoveTo( mBuffer );
+         a.Reset();
+      }
+      else
+      {
+         mConcept = std::exchange( a.mConcept, nullptr );
+      }
+   }
+
+   void Reset()
+   {
+      if( mConcept == nullptr )
+      {
+         return;
+      }
+      if( Inline() )
+      {
+         mConcept->~Concept();
+      }
+      else
+      {
+         mConcept->Destroy( mAllocator );
+      }
+      mConcept = nullptr;
+   }
+
+   alignas( std::max_align_t ) unsigned char mBuffer[ N ];
+   Concept* mConcept = nullptr;
+   A mAllocator;
+};
+
+template< class T >
+AnyEnumerable( d::Shim< T > ) -> AnyEnumerable< typename d::Shim< T >::ValueType >;
+
+namespace d
+{
+template< class V, size_t N, class A >
+struct AnyEnumerableShim
+{
+   using Iterator = typename EnumerableShim< V >::Iterator;
+
+   AnyEnumerable< V, N, A > mEnumerable;
+
+   SizeHint GetSizeHint() const
+   {
+      return mEnumerable.GetSizeHint();
+   }
+
+   Iterator CreateIterator() const
+   {
+      return Iterator{ mEnumerable.Get() };
+   }
+};
+} // namespace d
+
+template< class V, size_t N, class A >
+d::Shim< d::AnyEnumerableShim< V, N, A > > From( AnyEnumerable< V, N, A > t )
+{
+   return { { { std::move( t ) } } };
+}
+} // namespace linq
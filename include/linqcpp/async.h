@@ -0,0 +1,275 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+
+// Awaitable terminal operators, for coroutines that must not block, on an event loop for instance:
+//
+//   linq::Channel< Record > records; // the loop pushes the records as they arrive and closes the channel at the end
+//   auto errors = co_await From( records ).Where( []( const Record& m ) { return m.mError; } ).AsAsync( post ).ToVectorAsync();
+//
+// The query runs on a thread of its own, so it may wait for a channel without holding up the loop. post( handle ) resumes
+// the awaiting coroutine where the loop wants it; without it the coroutine goes on on the thread of the query.
+
+#if !defined( __cpp_impl_coroutine ) || !__has_include( <coroutine> )
+#error "linqcpp/async.h requires C++20 coroutines."
+#endif
+
+#include "linqcpp.h"
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace linq
+{
+// A queue that one side fills and a query drains; the query waits for the next element until the channel is closed.
+template< class V >
+class Channel
+{
+public:
+   void Push( V value )
+   {
+      {
+         std::lock_guard< std::mutex > lock( mMutex );
+         mQueue.push_back( std::move( value ) );
+      }
+      mCondition.notify_one();
+   }
+
+   void Close()
+   {
+      {
+         std::lock_guard< std::mutex > lock( mMutex );
+         mClosed = true;
+      }
+      mCondition.notify_all();
+   }
+
+   d::optional< V > Pop()
+   {
+      std::unique_lock< std::mutex > lock( mMutex );
+      mCondition.wait( lock, [ this ] { return !mQueue.empty() || mClosed; } );
+      if( mQueue.empty() )
+      {
+         return {};
+      }
+      d::optional< V > ret = std::move( mQueue.front() );
+      mQueue.pop_front();
+      return ret;
+   }
+
+private:
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque< V > mQueue;
+   bool mClosed = false;
+};
+
+using Scheduler = std::function< void( std::coroutine_handle<> ) >;
+
+namespace d
+{
+template< class V >
+struct ChannelShim
+{
+   struct Iterator
+   {
+      using ResultType = optional< V >;
+
+      using pointer = typename ResultType::pointer_type;
+      using value_type = typename ResultType::value_type;
+      using reference = typename ResultType::reference_type;
+
+      Channel< V >* mChannel;
+
+      ResultType Next() const
+      {
+         return mChannel->Pop();
+      }
+
+      bool operator==( const Iterator& ) const
+      {
+         return false;
+      }
+   };
+
+   Channel< V >* mChannel;
+
+   SizeHint GetSizeHint() const
+   {
+      return SizeHint::Unknown();
+   }
+
+   Iterator CreateIterator() const
+   {
+      return { mChannel };
+   }
+};
+
+// Awaiting it runs f on a new thread and suspends the coroutine until f returns.
+template< class F >
+class AsyncResult
+{
+public:
+   using ResultType = std::invoke_result_t< F& >;
+
+   static_assert( !std::is_void< ResultType >::value, "The operator must return a value." );
+
+   AsyncResult( F f, Scheduler scheduler )
+      : mRun{ std::move( f ) }
+      , mScheduler{ std::move( scheduler ) }
+   {
+   }
+
+   bool await_ready() const noexcept
+   {
+      return false;
+   }
+
+   // The scheduler is copied, since the awaiter may be gone as soon as the coroutine is resumed.
+   void await_suspend( std::coroutine_handle<> handle )
+   {
+      std::thread( [ this, handle, scheduler = mScheduler ] {
+         try
+         {
+            mResult.emplace( mRun() );
+         }
+         catch( ... )
+         {
+            mException = std::current_exception();
+         }
+         if( scheduler )
+         {
+            scheduler( handle );
+         }
+         else
+         {
+            handle.resume();
+         }
+      } ).detach();
+   }
+
+   ResultType await_resume()
+   {
+      if( mException )
+      {
+         std::rethrow_exception( mException );
+      }
+      return std::move( *mResult );
+   }
+
+private:
+   F mRun;
+   Scheduler mScheduler;
+   std::optional< ResultType > mResult;
+   std::exception_ptr mException;
+};
+
+template< class T >
+class AsyncShim
+{
+public:
+   AsyncShim( Shim< T > shim, Scheduler scheduler )
+      : mShim{ std::move( shim ) }
+      , mScheduler{ std::move( scheduler ) }
+   {
+   }
+
+   // Awaits f( pipeline ).
+   template< class F >
+   auto Async( F f ) const&
+   {
+      return MakeResult( mShim, std::move( f ), mScheduler );
+   }
+
+   template< class F >
+   auto Async( F f ) &&
+   {
+      return MakeResult( std::move( mShim ), std::move( f ), std::move( mScheduler ) );
+   }
+
+   auto ToVectorAsync() const&
+   {
+      return Async( []( const auto& m ) { return m.ToVector(); } );
+   }
+
+   auto ToVectorAsync() &&
+   {
+      return std::move( *this ).Async( []( const auto& m ) { return m.ToVector(); } );
+   }
+
+   auto CountAsync() const&
+   {
+      return Async( []( const auto& m ) { return m.Count(); } );
+   }
+
+   auto CountAsync() &&
+   {
+      return std::move( *this ).Async( []( const auto& m ) { return m.Count(); } );
+   }
+
+private:
+   template< class S, class F >
+   static auto MakeResult( S&& shim, F f, Scheduler scheduler )
+   {
+      auto run = [ shim = std::forward< S >( shim ), f = std::move( f ) ]() mutable { return f( std::as_const( shim ) ); };
+      return AsyncResult< decltype( run ) >( std::move( run ), std::move( scheduler ) );
+   }
+
+   Shim< T > mShim;
+   Scheduler mScheduler;
+};
+
+template< class T >
+auto Shim< T >::AsAsync() const&
+{
+   return AsyncShim< T >( *this, nullptr );
+}
+
+template< class T >
+auto Shim< T >::AsAsync() &&
+{
+   return AsyncShim< T >( std::move( *this ), nullptr );
+}
+
+template< class T >
+template< class S >
+auto Shim< T >::AsAsync( S&& scheduler ) const&
+{
+   return AsyncShim< T >( *this, std::forward< S >( scheduler ) );
+}
+
+template< class T >
+template< class S >
+auto Shim< T >::AsAsync( S&& scheduler ) &&
+{
+   return AsyncShim< T >( std::move( *this ), std::forward< S >( scheduler ) );
+}
+} // namespace d
+
+template< class V >
+d::Shim< d::ChannelShim< V > > From( Channel< V >& channel )
+{
+   return { { &channel } };
+}
+} // namespace linq
@@ -0,0 +1,211 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace linq
+{
+namespace d
+{
+constexpr size_t BatchSize = 128;
+
+// Caller-provided buffer for NextBatch(). Values are constructed in place.
+template< class V, size_t N = BatchSize >
+struct Batch
+{
+   static constexpr size_t Capacity = N;
+
+   union Storage
+   {
+      Storage()
+      {
+      }
+
+      ~Storage()
+      {
+      }
+
+      V mValues[ N ];
+   };
+
+   Storage mStorage;
+   size_t mSize = 0;
+
+   Batch() = default;
+   Batch( const Batch& ) = delete;
+   Batch& operator=( const Batch& ) = delete;
+
+   ~Batch()
+   {
+      Clear();
+   }
+
+   size_t Size() const
+   {
+      return mSize;
+   }
+
+   bool Full() const
+   {
+      return mSize == N;
+   }
+
+   V* Data()
+   {
+      return mStorage.mValues;
+   }
+
+   V& operator[]( size_t i )
+   {
+      return mStorage.mValues[ i ];
+   }
+
+   template< class X >
+   void Push( X&& x )
+   {
+      new( std::addressof( mStorage.mValues[ mSize ] ) ) V( std::forward< X >( x ) );
+      ++mSize;
+   }
+
+   // Takes in the size values written straight into Data() past the current ones.
+   void Commit( size_t size )
+   {
+      static_assert( std::is_trivially_copyable< V >::value );
+      mSize += size;
+   }
+
+   void Clear()
+   {
+      if constexpr( !std::is_trivially_destructible< V >::value )
+      {
+         for( size_t i = 0; i < mSize; ++i )
+         {
+            mStorage.mValues[ i ].~V();
+         }
+      }
+      mSize = 0;
+   }
+
+   template< class F >
+   void Each( F&& f )
+   {
+      for( size_t i = 0; i < mSize; ++i )
+      {
+         f( std::move( mStorage.mValues[ i ] ) );
+      }
+   }
+
+   template< class C >
+   void AppendTo( C& c )
+   {
+      c.insert( c.end(), std::make_move_iterator( Data() ), std::make_move_iterator( Data() + mSize ) );
+   }
+};
+
+// A batch of references either points straight into a contiguous source (a span) or holds the addresses of the elements.
+template< class V, size_t N >
+struct Batch< V&, N >
+{
+   static constexpr size_t Capacity = N;
+
+   V* mSpan = nullptr;
+   V* mRefs[ N ];
+   size_t mSize = 0;
+
+   Batch() = default;
+   Batch( const Batch& ) = delete;
+   Batch& operator=( const Batch& ) = delete;
+
+   size_t Size() const
+   {
+      return mSize;
+   }
+
+   bool Full() const
+   {
+      return mSize == N;
+   }
+
+   V* Data() const
+   {
+      return mSpan;
+   }
+
+   V& operator[]( size_t i ) const
+   {
+      return mSpan ? mSpan[ i ] : *mRefs[ i ];
+   }
+
+   template< class X >
+   void Push( X&& x )
+   {
+      mRefs[ mSize++ ] = std::addressof( static_cast< V& >( x ) );
+   }
+
+   void Assign( V* span, size_t size )
+   {
+      mSpan = span;
+      mSize = size;
+   }
+
+   void Clear()
+   {
+      mSpan = nullptr;
+      mSize = 0;
+   }
+
+   template< class F >
+   void Each( F&& f ) const
+   {
+      if( mSpan )
+      {
+         for( size_t i = 0; i < mSize; ++i )
+         {
+            f( mSpan[ i ] );
+         }
+      }
+      else
+      {
+         for( size_t i = 0; i < mSize; ++i )
+         {
+            f( *mRefs[ i ] );
+         }
+      }
+   }
+
+   template< class C >
+   void AppendTo( C& c ) const
+   {
+      if( mSpan )
+      {
+         c.insert( c.end(), mSpan, mSpan + mSize );
+      }
+      else
+      {
+         for( size_t i = 0; i < mSize; ++i )
+         {
+            c.insert( c.end(), *mRefs[ i ] );
+         }
+      }
+   }
+};
+} // namespace d
+} // namespace linq
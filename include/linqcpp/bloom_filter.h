@@ -0,0 +1,104 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace linq
+{
+namespace d
+{
+// A blocked Bloom filter over hash values: every key sets Probes bits of a single 64 bit word, so a query costs at most
+// one cache miss. At BitsPerKey bits per key it passes about 3% of the keys it has never seen.
+template< class A = std::allocator< uint64_t > >
+class BloomFilter
+{
+public:
+   static constexpr size_t BitsPerKey = 8;
+   static constexpr size_t Probes = 3;
+
+   BloomFilter() = default;
+
+   explicit BloomFilter( const A& a )
+      : mWords( a )
+   {
+   }
+
+   explicit BloomFilter( size_t size, const A& a = A() )
+      : mWords( a )
+   {
+      size_t words = 1;
+      mShift = 64;
+      while( words * 64 < size * BitsPerKey )
+      {
+         words *= 2;
+         --mShift;
+      }
+      mWords.resize( words );
+   }
+
+   bool Empty() const
+   {
+      return mWords.empty();
+   }
+
+   void Insert( size_t hash )
+   {
+      auto h = Mix( hash );
+      mWords[ Word( h ) ] |= Bits( h );
+   }
+
+   bool MayContain( size_t hash ) const
+   {
+      auto h = Mix( hash );
+      auto bits = Bits( h );
+      return ( mWords[ Word( h ) ] & bits ) == bits;
+   }
+
+private:
+   // The murmur finalizer, since std::hash of an integer is the integer itself.
+   static uint64_t Mix( uint64_t h )
+   {
+      h ^= h >> 33;
+      h *= 0xFF51AFD7ED558CCDull;
+      h ^= h >> 33;
+      h *= 0xC4CEB9FE1A85EC53ull;
+      h ^= h >> 33;
+      return h;
+   }
+
+   size_t Word( uint64_t h ) const
+   {
+      return mShift == 64 ? 0 : static_cast< size_t >( h >> mShift );
+   }
+
+   static uint64_t Bits( uint64_t h )
+   {
+      uint64_t ret = 0;
+      for( size_t i = 0; i < Probes; ++i )
+      {
+         ret |= uint64_t{ 1 } << ( ( h >> ( 6 * i ) ) & 63 );
+      }
+      return ret;
+   }
+
+   std::vector< uint64_t, A > mWords;
+   unsigned mShift = 64;
+};
+} // namespace d
+} // namespace linq
@@ -17,16 +17,26 @@
 #include "i_enumerable.h"
 #include "linqcpp.h"
 
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace linq
 {
 namespace d
 {
 
+// The iterator lives in a buffer of its own unless it is larger than InlineSize, and the elements come through the
+// virtual interface a batch at a time. Elements of a batch that a stopped ForEach() hasn't taken wait in mPending, which
+// is only allocated then.
 template< class V >
 struct EnumerableShim
 {
+   static constexpr size_t InlineSize = 128;
+
    struct Iterator
    {
       using ResultType = d::optional< V >;
@@ -34,29 +44,206 @@ struct EnumerableShim
       using value_type = typename ResultType::value_type;
       using reference = typename ResultType::reference_type;
 
-      std::unique_ptr< IEnumerableIterator< V > > mInnerIterator;
+      using Inner = IEnumerableIterator< V >;
+      using BatchType = typename Inner::BatchType;
+
+      explicit Iterator( const IEnumerable< V >& enumerable )
+         : mInnerIterator{ enumerable.CreateIterator( mBuffer, InlineSize ) }
+      {
+      }
+
+      Iterator( Iterator&& i ) noexcept
+      {
+         Take( std::move( i ) );
+      }
+
+      Iterator& operator=( Iterator&& i ) noexcept
+      {
+         if( this != &i )
+         {
+            Reset();
+            Take( std::move( i ) );
+         }
+         return *this;
+      }
+
+      ~Iterator()
+      {
+         Reset();
+      }
 
       ResultType Next() const
       {
+         if( HasPending() )
+         {
+            return Forward( ( *mPending )[ mPosition++ ] );
+         }
          return mInnerIterator->Next();
       }
 
+      static constexpr bool BatchPreferred = true;
+
+      template< class B >
+      size_t NextBatch( B& b ) const
+      {
+         b.Clear();
+         while( HasPending() && !b.Full() )
+         {
+            b.Push( Forward( ( *mPending )[ mPosition++ ] ) );
+         }
+         if( b.Size() != 0 )
+         {
+            return b.Size();
+         }
+         if constexpr( std::is_same< B, BatchType >::value )
+         {
+            return mInnerIterator->NextBatch( b );
+         }
+         else
+         {
+            while( !b.Full() )
+            {
+               auto result = mInnerIterator->Next();
+               if( !result.is_initialized() )
+               {
+                  break;
+               }
+               b.Push( std::move( result ).value() );
+            }
+            return b.Size();
+         }
+      }
+
+      // The first element comes alone, so that First() and Any() don't produce a whole batch.
+      template< class S >
+      bool ForEach( S&& s ) const
+      {
+         if( HasPending() )
+         {
+            while( HasPending() )
+            {
+               if( !s( Forward( ( *mPending )[ mPosition++ ] ) ) )
+               {
+                  return false;
+               }
+            }
+         }
+         else
+         {
+            auto result = mInnerIterator->Next();
+            if( !result.is_initialized() )
+            {
+               return true;
+            }
+            if( !s( *std::move( result ) ) )
+            {
+               return false;
+            }
+         }
+
+         BatchType batch;
+         while( mInnerIterator->NextBatch( batch ) != 0 )
+         {
+            for( size_t i = 0; i < batch.Size(); ++i )
+            {
+               if( !s( Forward( batch[ i ] ) ) )
+               {
+                  Keep( batch, i + 1 );
+                  return false;
+               }
+            }
+         }
+         return true;
+      }
+
       bool operator==( const Iterator& i ) const
       {
-         return mInnerIterator->Eq( i.mInnerIterator.get() );
+         return mInnerIterator->Eq( i.mInnerIterator );
       }
+
+   private:
+      template< class X >
+      static decltype( auto ) Forward( X& x )
+      {
+         if constexpr( std::is_reference< V >::value )
+         {
+            return x;
+         }
+         else
+         {
+            return std::move( x );
+         }
+      }
+
+      bool HasPending() const
+      {
+         return mPending != nullptr && mPosition < mPending->Size();
+      }
+
+      void Keep( BatchType& batch, size_t from ) const
+      {
+         if( from == batch.Size() )
+         {
+            return;
+         }
+         if( mPending == nullptr )
+         {
+            mPending = std::make_unique< BatchType >();
+         }
+         mPending->Clear();
+         mPosition = 0;
+         for( ; from < batch.Size(); ++from )
+         {
+            mPending->Push( Forward( batch[ from ] ) );
+         }
+      }
+
+      bool Inline() const
+      {
+         auto p = reinterpret_cast< const unsigned char* >( mInnerIterator );
+         return std::less_equal<>()( mBuffer, p ) && std::less<>()( p, mBuffer + InlineSize );
+      }
+
+      void Take( Iterator&& i )
+      {
+         mInnerIterator = i.Inline() ? i.mInnerIterator->MoveTo( mBuffer ) : std::exchange( i.mInnerIterator, nullptr );
+         mPending = std::move( i.mPending );
+         mPosition = std::exchange( i.mPosition, 0 );
+      }
+
+      void Reset()
+      {
+         if( mInnerIterator == nullptr )
+         {
+            return;
+         }
+         if( Inline() )
+         {
+            mInnerIterator->~Inner();
+         }
+         else
+         {
+            delete mInnerIterator;
+         }
+         mInnerIterator = nullptr;
+      }
+
+      alignas( std::max_align_t ) unsigned char mBuffer[ InlineSize ];
+      Inner* mInnerIterator = nullptr;
+      mutable std::unique_ptr< BatchType > mPending;
+      mutable size_t mPosition = 0;
    };
 
    std::unique_ptr< IEnumerable< V > > mInnerEnumerable;
 
-   size_t GetCapacity() const
+   SizeHint GetSizeHint() const
    {
-      return mInnerEnumerable->GetCapacity();
+      return mInnerEnumerable->GetSizeHint();
    }
 
    Iterator CreateIterator() const
    {
-      return { mInnerEnumerable->CreateIterator() };
+      return Iterator{ *mInnerEnumerable };
    }
 };
 
@@ -78,14 +265,24 @@ struct EnumerableIterator : IEnumerableIterator< typename I::ResultType::value_t
       return mInnerIterator.Next();
    }
 
+   size_t NextBatch( typename base::BatchType& batch ) const override
+   {
+      return d::NextBatch( mInnerIterator, batch );
+   }
+
    bool Eq( const base* iterator ) const override
    {
       return mInnerIterator == static_cast< const EnumerableIterator* >( iterator )->mInnerIterator;
    }
+
+   base* MoveTo( void* buffer ) override
+   {
+      return new( buffer ) EnumerableIterator( std::move( *this ) );
+   }
 };
 
-template< class T >
-struct Enumerable : IEnumerable< typename T::ValueType >
+template< class T, class B = IEnumerable< typename T::ValueType > >
+struct Enumerable : B
 {
    T mInnerEnumerable;
 
@@ -99,10 +296,25 @@ struct Enumerable : IEnumerable< typename T::ValueType >
       return mInnerEnumerable.GetCapacity();
    }
 
+   SizeHint GetSizeHint() const override
+   {
+      return mInnerEnumerable.GetSizeHint();
+   }
+
    std::unique_ptr< IEnumerableIterator< typename T::ValueType > > CreateIterator() const override
    {
       return std::unique_ptr< IEnumerableIterator< typename T::ValueType > >{ new EnumerableIterator{ mInnerEnumerable.CreateIterator() } };
    }
+
+   IEnumerableIterator< typename T::ValueType >* CreateIterator( void* buffer, size_t size ) const override
+   {
+      using I = EnumerableIterator< decltype( mInnerEnumerable.CreateIterator() ) >;
+      if( sizeof( I ) <= size && alignof( I ) <= alignof( std::max_align_t ) )
+      {
+         return new( buffer ) I{ mInnerEnumerable.CreateIterator() };
+      }
+      return new I{ mInnerEnumerable.CreateIterator() };
+   }
 };
 
 template< class T >
@@ -0,0 +1,265 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+
+// Sources over the contents of a file, without copies:
+//
+//   FromFileLines( "access.log" ).Where( []( std::string_view m ) { return m.find( " 500 " ) != m.npos; } ).Count();
+//   FromFileRecords< Sample >( "samples.bin" ).AsParallel().Select< double >( []( const Sample& m ) { return m.mValue; } ).Sum();
+//
+// The file is mapped for sequential reading where the platform has mmap, and read into memory with large reads
+// otherwise or when it can't be mapped, a pipe for instance. The views and references point into the file, which stays
+// in memory as long as some copy of the pipeline does.
+
+#include "linqcpp.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LINQCPP_MMAP
+#else
+#include <fstream>
+#endif
+
+namespace linq
+{
+namespace d
+{
+class FileView
+{
+public:
+   static constexpr size_t ReadSize = size_t{ 1 } << 20;
+
+   // map = false reads the file even where it could be mapped.
+   explicit FileView( const std::filesystem::path& path, bool map = true )
+   {
+#ifdef LINQCPP_MMAP
+      auto fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+      if( fd < 0 )
+      {
+         throw std::system_error( errno, std::generic_category(), "The file can't be opened." );
+      }
+      struct stat status;
+      auto regular = ::fstat( fd, &status ) == 0 && S_ISREG( status.st_mode );
+      if( map && regular && status.st_size > 0 )
+      {
+         auto size = static_cast< size_t >( status.st_size );
+         auto p = ::mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+         if( p != MAP_FAILED )
+         {
+            ::madvise( p, size, MADV_SEQUENTIAL );
+            ::close( fd );
+            mData = static_cast< const char* >( p );
+            mSize = size;
+            mMapped = true;
+            return;
+         }
+      }
+      try
+      {
+         Read( fd, regular ? static_cast< size_t >( status.st_size ) : 0 );
+      }
+      catch( ... )
+      {
+         ::close( fd );
+         throw;
+      }
+      ::close( fd );
+#else
+      (void)map;
+      std::ifstream in( path, std::ios::binary );
+      if( !in )
+      {
+         throw std::runtime_error( "The file can't be opened." );
+      }
+      for( size_t size = 0;; )
+      {
+         mBuffer.resize( size + ReadSize );
+         in.read( mBuffer.data() + size, ReadSize );
+         size += static_cast< size_t >( in.gcount() );
+         if( !in )
+         {
+            if( !in.eof() )
+            {
+               throw std::runtime_error( "The file can't be read." );
+            }
+            mBuffer.resize( size );
+            break;
+         }
+      }
+      mData = mBuffer.data();
+      mSize = mBuffer.size();
+#endif
+   }
+
+   FileView( const FileView& ) = delete;
+   FileView& operator=( const FileView& ) = delete;
+
+   ~FileView()
+   {
+#ifdef LINQCPP_MMAP
+      if( mMapped )
+      {
+         ::munmap( const_cast< char* >( mData ), mSize );
+      }
+#endif
+   }
+
+   const char* Data() const
+   {
+      return mData;
+   }
+
+   size_t Size() const
+   {
+      return mSize;
+   }
+
+   bool Mapped() const
+   {
+      return mMapped;
+   }
+
+private:
+#ifdef LINQCPP_MMAP
+   void Read( int fd, size_t sizeHint )
+   {
+      mBuffer.reserve( sizeHint );
+      for( size_t size = 0;; )
+      {
+         mBuffer.resize( size + ReadSize );
+         auto n = ::read( fd, mBuffer.data() + size, ReadSize );
+         if( n < 0 )
+         {
+            if( errno == EINTR )
+            {
+               continue;
+            }
+            throw std::system_error( errno, std::generic_category(), "The file can't be read." );
+         }
+         size += static_cast< size_t >( n );
+         if( n == 0 )
+         {
+            mBuffer.resize( size );
+            break;
+         }
+      }
+      mData = mBuffer.data();
+      mSize = mBuffer.size();
+   }
+#endif
+
+   const char* mData = nullptr;
+   size_t mSize = 0;
+   bool mMapped = false;
+   std::vector< char > mBuffer;
+};
+
+// Lines end with '\n' or "\r\n", which the views leave out; the last line may lack it.
+struct FileLinesShim
+{
+   struct Iterator
+   {
+      using ResultType = optional< std::string_view >;
+
+      using pointer = typename ResultType::pointer_type;
+      using value_type = typename ResultType::value_type;
+      using reference = typename ResultType::reference_type;
+
+      mutable const char* mPosition;
+      const char* mEnd;
+
+      ResultType Next() const
+      {
+         if( mPosition == mEnd )
+         {
+            return {};
+         }
+         auto begin = mPosition;
+         auto eol = static_cast< const char* >( std::memchr( begin, '\n', static_cast< size_t >( mEnd - begin ) ) );
+         auto end = eol == nullptr ? mEnd : eol;
+         mPosition = eol == nullptr ? mEnd : eol + 1;
+         if( end != begin && end[ -1 ] == '\r' )
+         {
+            --end;
+         }
+         return std::string_view( begin, static_cast< size_t >( end - begin ) );
+      }
+
+      bool operator==( const Iterator& i ) const
+      {
+         return mPosition == i.mPosition;
+      }
+   };
+
+   std::shared_ptr< const FileView > mFile;
+
+   // Every line takes a byte at least.
+   SizeHint GetSizeHint() const
+   {
+      auto size = mFile->Size();
+      return { size == 0 ? 0u : 1u, size, size == 0 };
+   }
+
+   Iterator CreateIterator() const
+   {
+      return { mFile->Data(), mFile->Data() + mFile->Size() };
+   }
+};
+
+// A contiguous source over the records, so that AsParallel() and the simd kernels take it like a vector.
+template< class T >
+struct FileRecordsShim : StdItShim< const T* >
+{
+   std::shared_ptr< const FileView > mFile;
+};
+} // namespace d
+
+inline d::Shim< d::FileLinesShim > FromFileLines( const std::filesystem::path& path )
+{
+   return { { std::make_shared< const d::FileView >( path ) } };
+}
+
+// The file holds T as it lies in memory; its size must be a multiple of sizeof( T ).
+template< class T >
+d::Shim< d::FileRecordsShim< T > > FromFileRecords( const std::filesystem::path& path )
+{
+   static_assert( std::is_trivially_copyable< T >::value, "The records must be trivially copyable." );
+   static_assert( alignof( T ) <= alignof( std::max_align_t ), "The records must not be over-aligned." );
+
+   auto file = std::make_shared< const d::FileView >( path );
+   if( file->Size() % sizeof( T ) != 0 )
+   {
+      throw std::length_error( "The file size isn't a multiple of the record size." );
+   }
+   auto begin = reinterpret_cast< const T* >( file->Data() );
+   auto count = file->Size() / sizeof( T );
+   return { { { { begin + count, begin, count }, std::move( file ) } } };
+}
+} // namespace linq
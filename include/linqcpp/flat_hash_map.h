@@ -0,0 +1,211 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+
+#include "optional.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace linq
+{
+namespace d
+{
+// std::hash, except that strings hash through string views, so that string keys can be looked up by a view or by a
+// literal without a copy.
+template< class K >
+struct Hash : std::hash< K >
+{
+};
+
+template< class C, class Tr, class A >
+struct Hash< std::basic_string< C, Tr, A > >
+{
+   size_t operator()( std::basic_string_view< C, Tr > key ) const
+   {
+      return std::hash< std::basic_string_view< C, Tr > >()( key );
+   }
+};
+
+// An open addressing hash map with linear probing. The entries live in the slots themselves, so a lookup usually costs
+// one cache miss; the load stays under 3/4. Iteration follows the slots, not the insertion order.
+template< class K, class V, class H = Hash< K >, class E = std::equal_to<>, class A = std::allocator< std::pair< K, V > > >
+class FlatHashMap
+{
+public:
+   using Entry = std::pair< K, V >;
+   using Slot = optional< Entry >;
+   using AllocatorType = A;
+   using SlotVector = std::vector< Slot, typename std::allocator_traits< A >::template rebind_alloc< Slot > >;
+
+   FlatHashMap() = default;
+
+   explicit FlatHashMap( const A& a )
+      : mSlots( typename SlotVector::allocator_type( a ) )
+   {
+   }
+
+   A GetAllocator() const
+   {
+      return A( mSlots.get_allocator() );
+   }
+
+   size_t Size() const
+   {
+      return mSize;
+   }
+
+   bool Empty() const
+   {
+      return mSize == 0;
+   }
+
+   void Reserve( size_t size )
+   {
+      auto slots = MinSlots;
+      while( slots / 4 * 3 < size )
+      {
+         slots *= 2;
+      }
+      if( slots > mSlots.size() )
+      {
+         Rehash( slots );
+      }
+   }
+
+   // The value of key, emplaced from args if key is new; the flag tells whether it is.
+   template< class X, class... Args >
+   std::pair< V*, bool > TryEmplace( X&& key, Args&&... args )
+   {
+      if( ( mSize + 1 ) * 4 > mSlots.size() * 3 )
+      {
+         Rehash( mSlots.empty() ? MinSlots : mSlots.size() * 2 );
+      }
+      for( auto i = Home( mHash( key ) );; i = ( i + 1 ) & ( mSlots.size() - 1 ) )
+      {
+         auto& slot = mSlots[ i ];
+         if( !slot.is_initialized() )
+         {
+            slot.emplace( std::piecewise_construct, std::forward_as_tuple( std::forward< X >( key ) ), std::forward_as_tuple( std::forward< Args >( args )... ) );
+            ++mSize;
+            return { &slot.value().second, true };
+         }
+         if( mEqual( slot.value().first, key ) )
+         {
+            return { &slot.value().second, false };
+         }
+      }
+   }
+
+   template< class X >
+   size_t Hash( const X& key ) const
+   {
+      return mHash( key );
+   }
+
+   template< class X >
+   const V* Find( const X& key ) const
+   {
+      return Find( key, mHash( key ) );
+   }
+
+   // Find() for a key whose Hash() is known already.
+   template< class X >
+   const V* Find( const X& key, size_t hash ) const
+   {
+      if( mSize == 0 )
+      {
+         return nullptr;
+      }
+      for( auto i = Home( hash );; i = ( i + 1 ) & ( mSlots.size() - 1 ) )
+      {
+         auto& slot = mSlots[ i ];
+         if( !slot.is_initialized() )
+         {
+            return nullptr;
+         }
+         if( mEqual( slot.value().first, key ) )
+         {
+            return &slot.value().second;
+         }
+      }
+   }
+
+   template< class X >
+   V* Find( const X& key )
+   {
+      return const_cast< V* >( std::as_const( *this ).Find( key ) );
+   }
+
+   // The slots, empty ones included.
+   SlotVector& Slots()
+   {
+      return mSlots;
+   }
+
+   const SlotVector& Slots() const
+   {
+      return mSlots;
+   }
+
+private:
+   static constexpr size_t MinSlots = 16;
+
+   // Fibonacci hashing spreads the weak std::hash of integers over the top bits.
+   size_t Home( size_t hash ) const
+   {
+      return static_cast< size_t >( ( static_cast< uint64_t >( hash ) * 0x9E3779B97F4A7C15ull ) >> mShift );
+   }
+
+   void Rehash( size_t slots )
+   {
+      auto allocator = mSlots.get_allocator();
+      auto old = std::move( mSlots );
+      mSlots = SlotVector( slots, allocator );
+      mShift = 64;
+      for( auto s = slots; s > 1; s /= 2 )
+      {
+         --mShift;
+      }
+      for( auto& slot : old )
+      {
+         if( slot.is_initialized() )
+         {
+            auto i = Home( mHash( slot.value().first ) );
+            while( mSlots[ i ].is_initialized() )
+            {
+               i = ( i + 1 ) & ( slots - 1 );
+            }
+            mSlots[ i ].emplace( std::move( slot.value() ) );
+         }
+      }
+   }
+
+   SlotVector mSlots;
+   size_t mSize = 0;
+   unsigned mShift = 64;
+   H mHash;
+   E mEqual;
+};
+} // namespace d
+} // namespace linq
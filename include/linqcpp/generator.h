@@ -0,0 +1,306 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+
+// A coroutine generator, and a source over it:
+//
+//   linq::Generator< int > Numbers( int n )
+//   {
+//      for( int i = 0; i < n; ++i )
+//      {
+//         co_yield i;
+//      }
+//   }
+//
+//   From( Numbers( 100 ) ).Where( []( int m ) { return m % 2 == 0; } ).ToVector();
+//
+// co_yield linq::ElementsOf( other ) yields all of another generator. The nested generator is resumed directly, by
+// symmetric transfer, so that a deep recursion costs the same per element as a flat loop.
+
+#if !defined( __cpp_impl_coroutine ) || !__has_include( <coroutine> )
+#error "linqcpp/generator.h requires C++20 coroutines."
+#endif
+
+#include "linqcpp.h"
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace linq
+{
+template< class G >
+struct ElementsOfT
+{
+   G mGenerator;
+};
+
+template< class G >
+ElementsOfT< G > ElementsOf( G&& g )
+{
+   return { std::forward< G >( g ) };
+}
+
+// V is either the type of the elements or a reference to them. Yielding an lvalue to a generator of values copies it,
+// anything else is handed out by reference and stays in the coroutine until it is resumed.
+template< class V >
+class Generator
+{
+public:
+   using Reference = std::conditional_t< std::is_reference< V >::value, V, V&& >;
+   using Value = std::remove_cv_t< std::remove_reference_t< V > >;
+
+   struct promise_type
+   {
+      using Handle = std::coroutine_handle< promise_type >;
+
+      std::add_pointer_t< Reference > mValue = nullptr;
+      std::exception_ptr mException;
+      // The root is the generator of the consumer; it knows the innermost nested one, which is the one to resume.
+      promise_type* mRoot = this;
+      promise_type* mLeaf = this;
+      Handle mParent;
+
+      struct Copy
+      {
+         Value mValue;
+         promise_type* mPromise;
+
+         bool await_ready() const noexcept
+         {
+            return false;
+         }
+
+         void await_suspend( Handle ) noexcept
+         {
+            mPromise->mRoot->mValue = std::addressof( mValue );
+         }
+
+         void await_resume() const noexcept
+         {
+         }
+      };
+
+      struct Nested
+      {
+         Generator mChild;
+
+         bool await_ready() const noexcept
+         {
+            return !mChild.mHandle;
+         }
+
+         std::coroutine_handle<> await_suspend( Handle h ) noexcept
+         {
+            auto& child = mChild.mHandle.promise();
+            child.mRoot = h.promise().mRoot;
+            child.mParent = h;
+            child.mRoot->mLeaf = &child;
+            return mChild.mHandle;
+         }
+
+         void await_resume()
+         {
+            if( mChild.mHandle && mChild.mHandle.promise().mException )
+            {
+               std::rethrow_exception( mChild.mHandle.promise().mException );
+            }
+         }
+      };
+
+      struct Final
+      {
+         bool await_ready() const noexcept
+         {
+            return false;
+         }
+
+         std::coroutine_handle<> await_suspend( Handle h ) noexcept
+         {
+            auto& promise = h.promise();
+            if( promise.mParent )
+            {
+               promise.mRoot->mLeaf = &promise.mParent.promise();
+               return promise.mParent;
+            }
+            return std::noop_coroutine();
+         }
+
+         void await_resume() const noexcept
+         {
+         }
+      };
+
+      Generator get_return_object()
+      {
+         return Generator( Handle::from_promise( *this ) );
+      }
+
+      std::suspend_always initial_suspend() const noexcept
+      {
+         return {};
+      }
+
+      Final final_suspend() const noexcept
+      {
+         return {};
+      }
+
+      std::suspend_always yield_value( Reference value ) noexcept
+      {
+         mRoot->mValue = std::addressof( value );
+         return {};
+      }
+
+      template< class U = V, std::enable_if_t< !std::is_reference< U >::value, int > = 0 >
+      Copy yield_value( const Value& value )
+      {
+         return { value, this };
+      }
+
+      Nested yield_value( ElementsOfT< Generator > elements ) noexcept
+      {
+         return { std::move( elements.mGenerator ) };
+      }
+
+      template< class U >
+      void await_transform( U&& ) = delete;
+
+      void return_void() const noexcept
+      {
+      }
+
+      void unhandled_exception()
+      {
+         mException = std::current_exception();
+      }
+   };
+
+   using Handle = typename promise_type::Handle;
+
+   Generator( Generator&& g ) noexcept
+      : mHandle{ std::exchange( g.mHandle, nullptr ) }
+   {
+   }
+
+   Generator& operator=( Generator&& g ) noexcept
+   {
+      if( this != &g )
+      {
+         Reset();
+         mHandle = std::exchange( g.mHandle, nullptr );
+      }
+      return *this;
+   }
+
+   ~Generator()
+   {
+      Reset();
+   }
+
+   // Runs the coroutine to its next element; false when it has finished.
+   bool MoveNext()
+   {
+      if( !mHandle || mHandle.done() )
+      {
+         return false;
+      }
+      auto& root = mHandle.promise();
+      root.mValue = nullptr;
+      Handle::from_promise( *root.mLeaf ).resume();
+      if( root.mException )
+      {
+         std::rethrow_exception( std::exchange( root.mException, nullptr ) );
+      }
+      return !mHandle.done();
+   }
+
+   Reference Current() const
+   {
+      return static_cast< Reference >( *mHandle.promise().mValue );
+   }
+
+private:
+   explicit Generator( Handle handle )
+      : mHandle{ handle }
+   {
+   }
+
+   void Reset()
+   {
+      if( mHandle )
+      {
+         mHandle.destroy();
+         mHandle = nullptr;
+      }
+   }
+
+   Handle mHandle;
+};
+
+namespace d
+{
+// The generator is shared by the copies of the pipeline and runs only once, like a stream.
+template< class V >
+struct GeneratorShim
+{
+   struct Iterator
+   {
+      using ResultType = optional< V >;
+
+      using pointer = typename ResultType::pointer_type;
+      using value_type = typename ResultType::value_type;
+      using reference = typename ResultType::reference_type;
+
+      Generator< V >* mGenerator;
+
+      ResultType Next() const
+      {
+         if( !mGenerator->MoveNext() )
+         {
+            return {};
+         }
+         return mGenerator->Current();
+      }
+
+      bool operator==( const Iterator& ) const
+      {
+         return false;
+      }
+   };
+
+   std::shared_ptr< Generator< V > > mGenerator;
+
+   SizeHint GetSizeHint() const
+   {
+      return SizeHint::Unknown();
+   }
+
+   Iterator CreateIterator() const
+   {
+      return { mGenerator.get() };
+   }
+};
+} // namespace d
+
+template< class V >
+d::Shim< d::GeneratorShim< V > > From( Generator< V > g )
+{
+   return { { std::make_shared< Generator< V > >( std::move( g ) ) } };
+}
+} // namespace linq
@@ -0,0 +1,333 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+// Immutable lookup structures that are built once and probed by many queries:
+//
+//   auto blocked = From( blocklist ).ToHashIndex();
+//   From( requests ).Exclude( blocked, []( const Request& m ) { return m.mUser; } ).ToVector();
+//
+// Copies of an index share its data, and every method is const, so one index can serve any number of threads.
+
+#include "bloom_filter.h"
+#include "flat_hash_map.h"
+#include "sort.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace linq
+{
+namespace d
+{
+// Tables of at least this many keys get a Bloom filter in front of them.
+constexpr size_t BloomMin = size_t{ 1 } << 16;
+
+// The filter allocates like the table.
+template< class Table >
+auto Prefilter( const Table& table )
+{
+   using A = typename std::allocator_traits< typename Table::AllocatorType >::template rebind_alloc< uint64_t >;
+   BloomFilter< A > ret( A( table.GetAllocator() ) );
+   if( table.Size() >= BloomMin )
+   {
+      ret = BloomFilter< A >( table.Size(), A( table.GetAllocator() ) );
+      for( auto& slot : table.Slots() )
+      {
+         if( slot.is_initialized() )
+         {
+            ret.Insert( table.Hash( slot.value().first ) );
+         }
+      }
+   }
+   return ret;
+}
+
+template< class Table, class B, class X >
+const typename Table::Entry::second_type* Probe( const Table& table, const B& bloom, const X& key )
+{
+   if( table.Empty() )
+   {
+      return nullptr;
+   }
+   auto hash = table.Hash( key );
+   if( !bloom.Empty() && !bloom.MayContain( hash ) )
+   {
+      return nullptr;
+   }
+   return table.Find( key, hash );
+}
+
+// The elements of an index with one key, or all of them.
+template< class V >
+class IndexRange
+{
+public:
+   using iterator = const V*;
+   using const_iterator = const V*;
+
+   IndexRange() = default;
+
+   IndexRange( const V* begin, const V* end )
+      : mBegin{ begin }
+      , mEnd{ end }
+   {
+   }
+
+   const V* begin() const
+   {
+      return mBegin;
+   }
+
+   const V* end() const
+   {
+      return mEnd;
+   }
+
+   size_t size() const
+   {
+      return static_cast< size_t >( mEnd - mBegin );
+   }
+
+   bool empty() const
+   {
+      return mBegin == mEnd;
+   }
+
+private:
+   const V* mBegin = nullptr;
+   const V* mEnd = nullptr;
+};
+
+template< class I >
+struct IsIndex : std::false_type
+{
+};
+} // namespace d
+
+// The elements grouped by key in a flat hash table. Each key maps to a slice of one array of elements, in which the
+// elements of a key keep their order.
+template< class K, class V >
+class HashIndex
+{
+public:
+   using Key = K;
+   using Value = V;
+   using Range = d::IndexRange< V >;
+   using iterator = const V*;
+   using const_iterator = const V*;
+
+   HashIndex()
+      : mData{ std::make_shared< Data >() }
+   {
+   }
+
+   template< class KS >
+   HashIndex( std::vector< V > values, KS&& keySelector )
+   {
+      auto data = std::make_shared< Data >();
+      auto& table = data->mTable;
+      table.Reserve( values.size() );
+
+      // Counts the elements of every key, turns the counts into offsets, then moves every element to its offset.
+      std::vector< std::pair< size_t, size_t >* > slices;
+      slices.reserve( values.size() );
+      for( auto& m : values )
+      {
+         auto slice = table.TryEmplace( keySelector( std::as_const( m ) ) ).first;
+         ++slice->second;
+         slices.push_back( slice );
+      }
+      size_t offset = 0;
+      for( auto& slot : table.Slots() )
+      {
+         if( slot.is_initialized() )
+         {
+            auto& slice = slot.value().second;
+            slice.first = offset;
+            offset += slice.second;
+            slice.second = slice.first;
+         }
+      }
+      std::vector< size_t > order( values.size() );
+      for( size_t i = 0; i < values.size(); ++i )
+      {
+         order[ slices[ i ]->second++ ] = i;
+      }
+      data->mValues.reserve( values.size() );
+      for( auto i : order )
+      {
+         data->mValues.push_back( std::move( values[ i ] ) );
+      }
+
+      data->mBloom = d::Prefilter( table );
+      mData = std::move( data );
+   }
+
+   size_t KeyCount() const
+   {
+      return mData->mTable.Size();
+   }
+
+   template< class X >
+   bool Contains( const X& key ) const
+   {
+      return d::Probe( mData->mTable, mData->mBloom, key ) != nullptr;
+   }
+
+   template< class X >
+   Range Find( const X& key ) const
+   {
+      auto slice = d::Probe( mData->mTable, mData->mBloom, key );
+      if( slice == nullptr )
+      {
+         return {};
+      }
+      auto values = mData->mValues.data();
+      return { values + slice->first, values + slice->second };
+   }
+
+   // All the elements, grouped by key.
+   size_t size() const
+   {
+      return mData->mValues.size();
+   }
+
+   const V* begin() const
+   {
+      return mData->mValues.data();
+   }
+
+   const V* end() const
+   {
+      return mData->mValues.data() + mData->mValues.size();
+   }
+
+private:
+   struct Data
+   {
+      d::FlatHashMap< K, std::pair< size_t, size_t > > mTable;
+      d::BloomFilter<> mBloom;
+      std::vector< V > mValues;
+   };
+
+   std::shared_ptr< const Data > mData;
+};
+
+// The elements sorted by key, stably. Besides lookups by key it answers range queries.
+template< class K, class V >
+class SortedIndex
+{
+public:
+   using Key = K;
+   using Value = V;
+   using Range = d::IndexRange< V >;
+   using iterator = const V*;
+   using const_iterator = const V*;
+
+   SortedIndex()
+      : mData{ std::make_shared< Data >() }
+   {
+   }
+
+   template< class KS >
+   SortedIndex( std::vector< V > values, KS&& keySelector )
+   {
+      auto data = std::make_shared< Data >();
+      d::sort::Sort( values, true, 0, keySelector );
+      data->mKeys.reserve( values.size() );
+      for( auto& m : values )
+      {
+         data->mKeys.push_back( keySelector( std::as_const( m ) ) );
+      }
+      data->mValues = std::move( values );
+      mData = std::move( data );
+   }
+
+   template< class X >
+   bool Contains( const X& key ) const
+   {
+      auto& keys = mData->mKeys;
+      auto it = std::lower_bound( keys.begin(), keys.end(), key );
+      return it != keys.end() && !( key < *it );
+   }
+
+   template< class X >
+   Range Find( const X& key ) const
+   {
+      auto& keys = mData->mKeys;
+      auto range = std::equal_range( keys.begin(), keys.end(), key );
+      return Slice( range.first - keys.begin(), range.second - keys.begin() );
+   }
+
+   // The elements with from <= key < to.
+   template< class X, class Y >
+   Range Between( const X& from, const Y& to ) const
+   {
+      auto& keys = mData->mKeys;
+      auto begin = std::lower_bound( keys.begin(), keys.end(), from );
+      auto end = std::lower_bound( begin, keys.end(), to );
+      return Slice( begin - keys.begin(), end - keys.begin() );
+   }
+
+   // All the elements, in key order.
+   size_t size() const
+   {
+      return mData->mValues.size();
+   }
+
+   const V* begin() const
+   {
+      return mData->mValues.data();
+   }
+
+   const V* end() const
+   {
+      return mData->mValues.data() + mData->mValues.size();
+   }
+
+private:
+   Range Slice( size_t begin, size_t end ) const
+   {
+      auto values = mData->mValues.data();
+      return { values + begin, values + end };
+   }
+
+   struct Data
+   {
+      std::vector< K > mKeys;
+      std::vector< V > mValues;
+   };
+
+   std::shared_ptr< const Data > mData;
+};
+
+namespace d
+{
+template< class K, class V >
+struct IsIndex< HashIndex< K, V > > : std::true_type
+{
+};
+
+template< class K, class V >
+struct IsIndex< SortedIndex< K, V > > : std::true_type
+{
+};
+} // namespace d
+} // namespace linq
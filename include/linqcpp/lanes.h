@@ -0,0 +1,373 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+// Placeholder expressions that the library can evaluate lane-wise:
+//
+//   From( vector ).Where( arg > 10 && arg < 20 ).Select< int >( arg * 2 + 1 ).ToVector();
+//   From( vector ).SelectWhere< int >( When( arg > 10, arg * 2 ) ).ToVector();
+//
+// An expression is also an ordinary callable, so it works with every operator and every source. Where, Select and
+// SelectWhere evaluate it on simd lanes when the elements are float, double or 32 bit integers and every constant in it
+// has exactly the element type; arg > 10 on doubles, for instance, stays scalar, arg > 10.0 doesn't.
+
+#include "optional.h"
+
+#include <type_traits>
+
+namespace linq
+{
+namespace d
+{
+namespace lanes
+{
+struct Plus
+{
+   static constexpr bool Mask = false;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static auto Apply( const A& a, const B& b )
+   {
+      return a + b;
+   }
+};
+
+struct Minus
+{
+   static constexpr bool Mask = false;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static auto Apply( const A& a, const B& b )
+   {
+      return a - b;
+   }
+};
+
+struct Multiplies
+{
+   static constexpr bool Mask = false;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static auto Apply( const A& a, const B& b )
+   {
+      return a * b;
+   }
+};
+
+struct Less
+{
+   static constexpr bool Mask = true;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static bool Apply( const A& a, const B& b )
+   {
+      return a < b;
+   }
+};
+
+struct LessEqual
+{
+   static constexpr bool Mask = true;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static bool Apply( const A& a, const B& b )
+   {
+      return a <= b;
+   }
+};
+
+struct Greater
+{
+   static constexpr bool Mask = true;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static bool Apply( const A& a, const B& b )
+   {
+      return a > b;
+   }
+};
+
+struct GreaterEqual
+{
+   static constexpr bool Mask = true;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static bool Apply( const A& a, const B& b )
+   {
+      return a >= b;
+   }
+};
+
+struct Equal
+{
+   static constexpr bool Mask = true;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static bool Apply( const A& a, const B& b )
+   {
+      return a == b;
+   }
+};
+
+struct NotEqual
+{
+   static constexpr bool Mask = true;
+   static constexpr bool Logical = false;
+
+   template< class A, class B >
+   static bool Apply( const A& a, const B& b )
+   {
+      return a != b;
+   }
+};
+
+struct And
+{
+   static constexpr bool Mask = true;
+   static constexpr bool Logical = true;
+
+   static bool Apply( bool a, bool b )
+   {
+      return a && b;
+   }
+};
+
+struct Or
+{
+   static constexpr bool Mask = true;
+   static constexpr bool Logical = true;
+
+   static bool Apply( bool a, bool b )
+   {
+      return a || b;
+   }
+};
+
+struct Arg
+{
+   template< class X >
+   const X& operator()( const X& x ) const
+   {
+      return x;
+   }
+};
+
+template< class C >
+struct Const
+{
+   C mValue;
+
+   template< class X >
+   const C& operator()( const X& ) const
+   {
+      return mValue;
+   }
+};
+
+template< class Op, class L, class R >
+struct Binary
+{
+   L mLhs;
+   R mRhs;
+
+   template< class X >
+   auto operator()( const X& x ) const
+   {
+      return Op::Apply( mLhs( x ), mRhs( x ) );
+   }
+};
+
+template< class C, class V >
+struct When
+{
+   C mCondition;
+   V mValue;
+
+   template< class X >
+   auto operator()( const X& x ) const
+   {
+      optional< std::decay_t< decltype( mValue( x ) ) > > ret;
+      if( mCondition( x ) )
+      {
+         ret = mValue( x );
+      }
+      return ret;
+   }
+};
+
+template< class E >
+struct IsExpr : std::false_type
+{
+};
+
+template<>
+struct IsExpr< Arg > : std::true_type
+{
+};
+
+template< class C >
+struct IsExpr< Const< C > > : std::true_type
+{
+};
+
+template< class Op, class L, class R >
+struct IsExpr< Binary< Op, L, R > > : std::true_type
+{
+};
+
+template< class E >
+struct IsMask : std::false_type
+{
+};
+
+template< class Op, class L, class R >
+struct IsMask< Binary< Op, L, R > > : std::integral_constant< bool, Op::Mask >
+{
+};
+
+// Whether E evaluates on lanes of T: constants of type T, comparisons of values, logic of comparisons.
+template< class E, class T >
+struct Fits : std::false_type
+{
+};
+
+template< class T >
+struct Fits< Arg, T > : std::true_type
+{
+};
+
+template< class C, class T >
+struct Fits< Const< C >, T > : std::is_same< C, T >
+{
+};
+
+template< class Op, class L, class R, class T >
+struct Fits< Binary< Op, L, R >, T >
+   : std::integral_constant< bool, Fits< L, T >::value && Fits< R, T >::value && IsMask< L >::value == Op::Logical && IsMask< R >::value == Op::Logical >
+{
+};
+
+template< class C, class V, class T >
+struct Fits< When< C, V >, T > : std::integral_constant< bool, Fits< C, T >::value && IsMask< C >::value && Fits< V, T >::value && !IsMask< V >::value >
+{
+};
+
+template< class L, class R >
+struct IsOperand : std::integral_constant< bool, ( IsExpr< L >::value && ( IsExpr< R >::value || std::is_arithmetic< R >::value ) ) ||
+                                                    ( std::is_arithmetic< L >::value && IsExpr< R >::value ) >
+{
+};
+
+template< class X >
+auto Wrap( const X& x )
+{
+   if constexpr( IsExpr< X >::value )
+   {
+      return x;
+   }
+   else
+   {
+      return Const< X >{ x };
+   }
+}
+
+template< class Op, class L, class R >
+using BinaryT = Binary< Op, decltype( Wrap( std::declval< const L& >() ) ), decltype( Wrap( std::declval< const R& >() ) ) >;
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< Plus, L, R > operator+( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< Minus, L, R > operator-( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< Multiplies, L, R > operator*( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< Less, L, R > operator<( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< LessEqual, L, R > operator<=( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< Greater, L, R > operator>( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< GreaterEqual, L, R > operator>=( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< Equal, L, R > operator==( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsOperand< L, R >::value, int > = 0 >
+BinaryT< NotEqual, L, R > operator!=( const L& l, const R& r )
+{
+   return { Wrap( l ), Wrap( r ) };
+}
+
+template< class L, class R, std::enable_if_t< IsExpr< L >::value && IsExpr< R >::value, int > = 0 >
+Binary< And, L, R > operator&&( const L& l, const R& r )
+{
+   return { l, r };
+}
+
+template< class L, class R, std::enable_if_t< IsExpr< L >::value && IsExpr< R >::value, int > = 0 >
+Binary< Or, L, R > operator||( const L& l, const R& r )
+{
+   return { l, r };
+}
+} // namespace lanes
+} // namespace d
+
+inline constexpr d::lanes::Arg arg{};
+
+// A SelectWhere() selector: the value of v for the elements satisfying c.
+template< class C, class V, std::enable_if_t< d::lanes::IsMask< C >::value && d::lanes::IsExpr< V >::value, int > = 0 >
+d::lanes::When< C, V > When( const C& c, const V& v )
+{
+   return { c, v };
+}
+} // namespace linq
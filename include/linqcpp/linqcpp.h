@@ -14,12 +14,27 @@
 
 #pragma once
 
+#include "batch.h"
+#include "flat_hash_map.h"
+#include "index.h"
 #include "optional.h"
+#include "parallel.h"
+#include "simd.h"
+#include "size_hint.h"
+#include "sort.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <list>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -101,7 +116,381 @@ struct ReferenceTraits< std::reference_wrapper< const optional< T > > >
    using Type = const optional< T >;
 };
 
+#if !defined( LINQCPP_OPTIONAL_BOOST ) && defined( __has_include )
+#if __has_include( <boost/optional/optional_fwd.hpp> )
+#define LINQCPP_BOOST_OPTIONAL_FWD
+#endif
+#endif
+
+#if defined( LINQCPP_BOOST_OPTIONAL_FWD )
+} // namespace d
+} // namespace linq
+
+#include <boost/optional/optional_fwd.hpp>
+
+namespace linq
+{
+namespace d
+{
+template< class T >
+struct ReferenceTraits< boost::optional< T >& >
+{
+   using Type = std::reference_wrapper< boost::optional< T > >;
+};
+
+template< class T >
+struct ReferenceTraits< const boost::optional< T >& >
+{
+   using Type = std::reference_wrapper< const boost::optional< T > >;
+};
+#endif
+
+template< class V, class X >
+constexpr decltype( auto ) ConvertV( X&& x )
+{
+   if constexpr( std::is_reference< V >::value || std::is_lvalue_reference< X >::value || !std::is_same< std::decay_t< X >, V >::value )
+   {
+      return static_cast< V >( std::forward< X >( x ) );
+   }
+   else
+   {
+      return std::forward< X >( x );
+   }
+}
+
+struct NoneSink
+{
+   template< class X >
+   bool operator()( X&& ) const
+   {
+      return true;
+   }
+};
+
+template< class I, class = void >
+struct HasForEach : std::false_type
+{
+};
+
+template< class I >
+struct HasForEach< I, std::void_t< decltype( std::declval< const I& >().ForEach( NoneSink{} ) ) > > : std::true_type
+{
+};
+
+// Pushes the remaining elements of the iterator into the sink until the sink returns false.
+// Returns true when the iterator is exhausted, false when the sink has stopped the iteration.
+// Iterators without a native ForEach are driven through Next().
+template< class I, class S >
+bool ForEach( const I& i, S&& s )
+{
+   if constexpr( HasForEach< I >::value )
+   {
+      return i.ForEach( std::forward< S >( s ) );
+   }
+   else
+   {
+      for( ;; )
+      {
+         auto result = i.Next();
+         if( !result.is_initialized() )
+         {
+            return true;
+         }
+         if( !s( std::move( result ).value() ) )
+         {
+            return false;
+         }
+      }
+   }
+}
+
+template< class I, class B, class = void >
+struct HasNextBatch : std::false_type
+{
+};
+
+template< class I, class B >
+struct HasNextBatch< I, B, std::void_t< decltype( std::declval< const I& >().NextBatch( std::declval< B& >() ) ) > > : std::true_type
+{
+};
+
+template< class I, class = void >
+struct IsBatchPreferred : std::false_type
+{
+};
+
+template< class I >
+struct IsBatchPreferred< I, std::enable_if_t< I::BatchPreferred > > : std::true_type
+{
+};
+
+template< class I, class B >
+size_t FillBatch( const I& i, B& b )
+{
+   b.Clear();
+   ForEach( i, [ & ]( auto&& v ) {
+      b.Push( std::forward< decltype( v ) >( v ) );
+      return !b.Full();
+   } );
+   return b.Size();
+}
+
+// Fills the batch with up to B::Capacity elements and returns their number; zero means the iterator is exhausted.
+template< class I, class B >
+size_t NextBatch( const I& i, B& b )
+{
+   if constexpr( HasNextBatch< I, B >::value )
+   {
+      return i.NextBatch( b );
+   }
+   else
+   {
+      return FillBatch( i, b );
+   }
+}
+
+// The batch as an array of T for the lane-wise kernels: a span or the values themselves, otherwise a copy in buffer.
+template< class T, class B >
+const T* LaneData( B& b, T* buffer )
+{
+   if( auto data = b.Data() )
+   {
+      return data;
+   }
+   for( size_t i = 0; i < b.Size(); ++i )
+   {
+      buffer[ i ] = b[ i ];
+   }
+   return buffer;
+}
+
+// Consumes the whole iterator, batch by batch where the iterator prefers it.
+template< class I, class F >
+void Drain( const I& i, F&& f )
+{
+   if constexpr( IsBatchPreferred< I >::value )
+   {
+      Batch< typename I::ResultType::value_type > batch;
+      while( NextBatch( i, batch ) )
+      {
+         batch.Each( f );
+      }
+   }
+   else
+   {
+      ForEach( i, [ & ]( auto&& v ) {
+         f( std::forward< decltype( v ) >( v ) );
+         return true;
+      } );
+   }
+}
+
+// Counts the remaining elements of the iterator.
+template< class I >
+size_t Count( const I& i )
+{
+   size_t ret = 0;
+   if constexpr( IsBatchPreferred< I >::value )
+   {
+      Batch< typename I::ResultType::value_type > batch;
+      while( auto size = NextBatch( i, batch ) )
+      {
+         ret += size;
+      }
+   }
+   else
+   {
+      ForEach( i, [ & ]( auto&& ) {
+         ++ret;
+         return true;
+      } );
+   }
+   return ret;
+}
+
+// Adds x to heap, a max-heap of less holding the k elements that come first in the order of less.
+template< class V, class X, class C >
+void HeapPush( std::vector< V >& heap, size_t k, X&& x, C& less )
+{
+   if( heap.size() < k )
+   {
+      heap.push_back( std::forward< X >( x ) );
+      std::push_heap( heap.begin(), heap.end(), less );
+   }
+   else if( less( x, heap.front() ) )
+   {
+      std::pop_heap( heap.begin(), heap.end(), less );
+      heap.back() = std::forward< X >( x );
+      std::push_heap( heap.begin(), heap.end(), less );
+   }
+}
+
+// Keeps in heap the k elements of the iterator that come first in the order of less; k must not be zero.
+template< class I, class V, class C >
+void HeapSelect( const I& i, size_t k, C& less, std::vector< V >& heap )
+{
+   ForEach( i, [ & ]( auto&& v ) {
+      HeapPush( heap, k, std::forward< decltype( v ) >( v ), less );
+      return true;
+   } );
+}
+
+template< class I, class = void >
+struct HasAdvance : std::false_type
+{
+};
+
+template< class I >
+struct HasAdvance< I, std::void_t< decltype( std::declval< const I& >().Advance( size_t{} ) ) > > : std::true_type
+{
+};
+
+// Skips up to n elements of the iterator.
+template< class I >
+void Advance( const I& i, size_t n )
+{
+   if constexpr( HasAdvance< I >::value )
+   {
+      i.Advance( n );
+   }
+   else if( n != 0 )
+   {
+      ForEach( i, [ & ]( auto&& ) { return --n != 0; } );
+   }
+}
+
+template< class I, class = void >
+struct IsRandomAccessIterator : std::false_type
+{
+};
+
 template< class I >
+struct IsRandomAccessIterator< I, std::void_t< typename std::iterator_traits< I >::iterator_category > >
+   : std::is_base_of< std::random_access_iterator_tag, typename std::iterator_traits< I >::iterator_category >
+{
+};
+
+// A random access shim knows its exact Size() and reaches any element with At( i ) without iterating.
+template< class T, class = void >
+struct IsRandomAccess : std::false_type
+{
+};
+
+template< class T >
+struct IsRandomAccess< T, std::void_t< decltype( std::declval< const T& >().Size() ), decltype( std::declval< const T& >().At( size_t{} ) ) > > : std::true_type
+{
+};
+
+// A contiguous shim is a random access one whose elements lie in one array starting at Data().
+template< class T, class = void >
+struct IsContiguous : std::false_type
+{
+};
+
+template< class T >
+struct IsContiguous< T, std::void_t< decltype( std::declval< const T& >().Data() ) > > : IsRandomAccess< T >
+{
+};
+
+// Terminal operators hand contiguous spans of arithmetic values to the simd kernels.
+template< class T, class V >
+struct IsSimd : std::integral_constant< bool, IsContiguous< T >::value && simd::IsSupported< V >::value >
+{
+};
+
+// A sorted shim promises that its elements ascend by operator<.
+template< class T, class = void >
+struct IsSorted : std::false_type
+{
+};
+
+template< class T >
+struct IsSorted< T, std::enable_if_t< T::Sorted > > : std::true_type
+{
+};
+
+// A stable shim yields lvalue references that stay valid as long as the shim: references into a container.
+template< class T, class = void >
+struct IsStable : std::false_type
+{
+};
+
+template< class T >
+struct IsStable< T, std::enable_if_t< T::Stable > > : std::true_type
+{
+};
+
+// A resourced shim allocates through the memory resource of a WithAllocator() stage upstream.
+template< class T, class = void >
+struct IsResourced : std::false_type
+{
+};
+
+template< class T >
+struct IsResourced< T, std::enable_if_t< T::Resourced > > : std::true_type
+{
+};
+
+template< class A, class = void >
+struct IsAllocator : std::false_type
+{
+};
+
+template< class A >
+struct IsAllocator< A, std::void_t< typename A::value_type, decltype( std::declval< A& >().allocate( size_t{} ) ) > > : std::true_type
+{
+};
+
+template< class A, class X, class = void >
+struct Rebind
+{
+};
+
+template< class A, class X >
+struct Rebind< A, X, std::enable_if_t< IsAllocator< A >::value > >
+{
+   using Type = typename std::allocator_traits< A >::template rebind_alloc< X >;
+};
+
+template< class A, class X >
+using RebindAllocator = typename Rebind< A, X >::Type;
+
+template< class I, class = void >
+struct IsContiguousIterator : std::is_pointer< I >
+{
+};
+
+template< class I >
+struct IsContiguousIterator< I, std::enable_if_t< !std::is_pointer< I >::value &&
+                                                  std::is_base_of< std::random_access_iterator_tag, typename std::iterator_traits< I >::iterator_category >::value &&
+                                                  std::is_object< typename std::iterator_traits< I >::value_type >::value &&
+                                                  !std::is_same< typename std::iterator_traits< I >::value_type, bool >::value > >
+   : std::integral_constant< bool, std::is_same< I, typename std::vector< typename std::iterator_traits< I >::value_type >::iterator >::value ||
+                                      std::is_same< I, typename std::vector< typename std::iterator_traits< I >::value_type >::const_iterator >::value >
+{
+};
+
+template< class T >
+struct IsContiguousContainer : std::false_type
+{
+};
+
+template< class T, class A >
+struct IsContiguousContainer< std::vector< T, A > > : std::integral_constant< bool, !std::is_same< T, bool >::value >
+{
+};
+
+template< class T, size_t N >
+struct IsContiguousContainer< std::array< T, N > > : std::true_type
+{
+};
+
+template< class C, class T, class A >
+struct IsContiguousContainer< std::basic_string< C, T, A > > : std::true_type
+{
+};
+
+template< class I, bool Contiguous = IsContiguousIterator< I >::value >
 struct StdItAdr
 {
    using Iterator = I;
@@ -129,6 +518,59 @@ struct StdItAdr
       return ret;
    }
 
+   template< class S >
+   bool ForEach( S&& s ) const
+   {
+      while( mCur != mEnd )
+      {
+         if( !s( static_cast< ReferenceType >( *mCur++ ) ) )
+         {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   void Advance( size_t n ) const
+   {
+      if constexpr( IsRandomAccessIterator< I >::value )
+      {
+         mCur += std::min< size_t >( n, static_cast< size_t >( mEnd - mCur ) );
+      }
+      else
+      {
+         for( ; n != 0 && mCur != mEnd; --n )
+         {
+            ++mCur;
+         }
+      }
+   }
+
+   static constexpr bool BatchPreferred = Contiguous && std::is_reference< ReferenceType >::value;
+
+   template< class B >
+   size_t NextBatch( B& b ) const
+   {
+      b.Clear();
+      if constexpr( BatchPreferred )
+      {
+         auto size = std::min< size_t >( B::Capacity, static_cast< size_t >( mEnd - mCur ) );
+         if( size != 0 )
+         {
+            b.Assign( std::addressof( *mCur ), size );
+            mCur += size;
+         }
+      }
+      else
+      {
+         while( mCur != mEnd && !b.Full() )
+         {
+            b.Push( static_cast< ReferenceType >( *mCur++ ) );
+         }
+      }
+      return b.Size();
+   }
+
    bool operator==( const StdItAdr& i ) const
    {
       return mCur == i.mCur;
@@ -236,6 +678,12 @@ StdItAdr< I > MakeIterator( I begin, I end )
    return { std::move( begin ), std::move( end ) };
 }
 
+template< bool Contiguous, class I >
+StdItAdr< I, Contiguous > MakeIterator( I begin, I end )
+{
+   return { std::move( begin ), std::move( end ) };
+}
+
 template< class I, class R, class F >
 struct ShimItF : ShimIt< I, R >
 {
@@ -252,37 +700,157 @@ ShimItF< I, R, F > MakeIteratorShim( I it, F&& f )
    return { { std::move( it ) }, std::forward< F >( f ) };
 }
 
-template< class T >
-struct ShimBase
+// The tokens of a buffer between delimiters, any byte of mDelimiters each; "a,,b" has "a", "" and "b", an empty buffer
+// none. The delimiters are found a block at a time, whose bits are taken lowest first.
+struct Splitter
 {
-   using DecayT = std::decay_t< T >;
+   static constexpr size_t Block = 64;
 
-   T mShim;
+   std::string_view mBuffer;
+   std::string_view mDelimiters;
+   size_t mPosition = 1;
+   size_t mNext = 0;
+   size_t mBlock = 0;
+   uint64_t mBits = 0;
 
-   size_t GetCapacity() const
+   Splitter() = default;
+
+   Splitter( std::string_view buffer, std::string_view delimiters )
+      : mBuffer{ buffer }
+      , mDelimiters{ delimiters }
+      , mPosition{ buffer.empty() ? 1u : 0u }
    {
-      return mShim.GetCapacity();
    }
-};
-
-template< class T >
-struct Shim : ShimBase< T >
-{
-   using base = ShimBase< T >;
-   using DecayT = typename base::DecayT;
-
-   using ValueType = typename DecayT::Iterator::ResultType::value_type;
-   using DecayValueType = typename ReferenceTraits< std::decay_t< ValueType > >::Type;
 
-   typename DecayT::Iterator CreateIterator() const
+   optional< std::string_view > Next()
    {
-      return this->mShim.CreateIterator();
-   };
-
+      for( ;; )
+      {
+         if( mBits != 0 )
+         {
+            auto end = mBlock + simd::LowestBit( mBits );
+            mBits &= mBits - 1;
+            return Take( end );
+         }
+         if( mNext < mBuffer.size() && !mDelimiters.empty() )
+         {
+            mBlock = mNext;
+            mNext += Block;
+            mBits = simd::MatchBytes( mBuffer.data() + mBlock, std::min( Block, mBuffer.size() - mBlock ), mDelimiters.data(), mDelimiters.size() );
+            continue;
+         }
+         if( mPosition > mBuffer.size() )
+         {
+            return {};
+         }
+         return Take( mBuffer.size() );
+      }
+   }
+
+private:
+   std::string_view Take( size_t end )
+   {
+      auto ret = mBuffer.substr( mPosition, end - mPosition );
+      mPosition = end + 1;
+      return ret;
+   }
+};
+
+// The fold of GroupBy: collects the elements of a group.
+struct Append
+{
+   template< class V, class X >
+   void operator()( std::vector< V >& v, X&& x ) const
+   {
+      v.push_back( std::forward< X >( x ) );
+   }
+};
+
+// Drains the iterator into a hash table, folding every element into the value of its key.
+template< class Table, class I, class KS, class F >
+void Index( Table& table, const I& i, KS&& keySelector, F&& fold )
+{
+   ForEach( i, [ & ]( auto&& v ) {
+      fold( *table.TryEmplace( keySelector( std::as_const( v ) ) ).first, std::forward< decltype( v ) >( v ) );
+      return true;
+   } );
+}
+
+// A key of an OrderBy stage.
+template< class F, bool D >
+struct SortKey
+{
+   using Functor = std::remove_reference_t< F >;
+   static constexpr bool Descending = D;
+
+   F mFunctor;
+};
+
+template< class T >
+struct ShimBase
+{
+   using DecayT = std::decay_t< T >;
+
+   static constexpr bool Resourced = IsResourced< DecayT >::value;
+
+   // The allocator of what the stage builds: polymorphic under WithAllocator(), the default one otherwise.
+   template< class X >
+   using Allocator = std::conditional_t< Resourced, std::pmr::polymorphic_allocator< X >, std::allocator< X > >;
+
+   T mShim;
+
+   SizeHint GetSizeHint() const
+   {
+      return mShim.GetSizeHint();
+   }
+
+   std::pmr::memory_resource* GetResource() const
+   {
+      return mShim.GetResource();
+   }
+
+   template< class X >
+   Allocator< X > GetAllocator() const
+   {
+      if constexpr( Resourced )
+      {
+         return Allocator< X >( GetResource() );
+      }
+      else
+      {
+         return {};
+      }
+   }
+};
+
+template< class T >
+struct Shim : ShimBase< T >
+{
+   using base = ShimBase< T >;
+   using DecayT = typename base::DecayT;
+
+   using ValueType = typename DecayT::Iterator::ResultType::value_type;
+   using DecayValueType = typename ReferenceTraits< std::decay_t< ValueType > >::Type;
+
+   template< class X >
+   using Allocator = typename base::template Allocator< X >;
+
+   typename DecayT::Iterator CreateIterator() const
+   {
+      return this->mShim.CreateIterator();
+   };
+
+   size_t GetCapacity() const
+   {
+      return this->mShim.GetSizeHint().Capacity( sizeof( DecayValueType ) );
+   }
+
    // Where
    template< class F >
    struct WhereShim : ShimBase< T >
    {
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
       struct Iterator : ShimIt< typename DecayT::Iterator >
       {
          using base = ShimIt< typename DecayT::Iterator >;
@@ -308,14 +876,75 @@ struct Shim : ShimBase< T >
                }
             }
          }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            return d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               if( f( v ) )
+               {
+                  return s( std::forward< decltype( v ) >( v ) );
+               }
+               return true;
+            } );
+         }
+
+         static constexpr bool BatchPreferred = simd::IsFilter< std::decay_t< F >, DecayValueType >::value && IsBatchPreferred< typename DecayT::Iterator >::value;
+
+         template< class B >
+         size_t NextBatch( B& b ) const
+         {
+            if constexpr( BatchPreferred )
+            {
+               Batch< ValueType, B::Capacity > batch;
+               DecayValueType buffer[ B::Capacity ];
+               uint32_t index[ B::Capacity ];
+               b.Clear();
+               while( auto size = d::NextBatch( this->mIterator, batch ) )
+               {
+                  auto count = simd::Filter( LaneData( batch, buffer ), size, mOwner->mFunctor, index );
+                  for( size_t i = 0; i < count; ++i )
+                  {
+                     b.Push( batch[ index[ i ] ] );
+                  }
+                  if( count != 0 )
+                  {
+                     break;
+                  }
+               }
+               return b.Size();
+            }
+            else
+            {
+               return FillBatch( *this, b );
+            }
+         }
       };
 
       F mFunctor;
 
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Filter();
+      }
+
       Iterator CreateIterator() const
       {
          return { { this->mShim.CreateIterator() }, this };
       };
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Partitioning GetPartitioning() const
+      {
+         return this->mShim.GetPartitioning();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Iterator CreateIterator( size_t begin, size_t end ) const
+      {
+         return { { this->mShim.CreateIterator( begin, end ) }, this };
+      };
    };
 
    template< class F >
@@ -330,6 +959,80 @@ struct Shim : ShimBase< T >
       return { { { { { std::forward< T >( this->mShim ) } }, std::forward< F >( f ) } } };
    }
 
+   // WhereWith
+   // Every iterator filters with its own copy of the state, so one pipeline can be enumerated again, or by several
+   // threads at once, as long as f itself keeps no state.
+   template< class S, class F >
+   struct WhereWithShim : ShimBase< T >
+   {
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = typename base::ResultType;
+
+         const WhereWithShim* mOwner;
+         mutable S mState;
+
+         ResultType Next() const
+         {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            for( ;; )
+            {
+               auto result = this->mIterator.Next();
+               if( !result.is_initialized() )
+               {
+                  return {};
+               }
+               if( f( mState, result.value() ) )
+               {
+                  return result;
+               }
+            }
+         }
+
+         template< class V >
+         bool ForEach( V&& s ) const
+         {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            return d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               if( f( mState, v ) )
+               {
+                  return s( std::forward< decltype( v ) >( v ) );
+               }
+               return true;
+            } );
+         }
+      };
+
+      S mSeed;
+      F mFunctor;
+
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Filter();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this, mSeed };
+      };
+   };
+
+   // The elements for which f( state, element ) holds, where state starts as a copy of seed for every enumeration.
+   template< class S, class F >
+   Shim< WhereWithShim< S, F > > WhereWith( S seed, F&& f ) const&
+   {
+      return { { { { { this->mShim } }, std::move( seed ), std::forward< F >( f ) } } };
+   }
+
+   template< class S, class F >
+   Shim< WhereWithShim< S, F > > WhereWith( S seed, F&& f ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::move( seed ), std::forward< F >( f ) } } };
+   }
+
    // Select
    template< class V, class F >
    struct SelectShim : ShimBase< T >
@@ -350,6 +1053,42 @@ struct Shim : ShimBase< T >
             }
             return {};
          }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            return d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               return s( ConvertV< V >( UnwrapReferenceV( f( std::forward< decltype( v ) >( v ) ) ) ) );
+            } );
+         }
+
+         void Advance( size_t n ) const
+         {
+            d::Advance( this->mIterator, n );
+         }
+
+         static constexpr bool BatchPreferred = simd::IsMap< std::decay_t< F >, DecayValueType >::value && std::is_same< V, DecayValueType >::value &&
+                                                IsBatchPreferred< typename DecayT::Iterator >::value;
+
+         template< class B >
+         size_t NextBatch( B& b ) const
+         {
+            if constexpr( BatchPreferred )
+            {
+               Batch< ValueType, B::Capacity > batch;
+               DecayValueType buffer[ B::Capacity ];
+               b.Clear();
+               auto size = d::NextBatch( this->mIterator, batch );
+               simd::Map( LaneData( batch, buffer ), size, mOwner->mFunctor, b.Data() );
+               b.Commit( size );
+               return size;
+            }
+            else
+            {
+               return FillBatch( *this, b );
+            }
+         }
       };
 
       F mFunctor;
@@ -358,6 +1097,30 @@ struct Shim : ShimBase< T >
       {
          return { { this->mShim.CreateIterator() }, this };
       };
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Partitioning GetPartitioning() const
+      {
+         return this->mShim.GetPartitioning();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Iterator CreateIterator( size_t begin, size_t end ) const
+      {
+         return { { this->mShim.CreateIterator( begin, end ) }, this };
+      };
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      size_t Size() const
+      {
+         return this->mShim.Size();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      V At( size_t i ) const
+      {
+         return ConvertV< V >( UnwrapReferenceV( const_cast< F& >( mFunctor )( this->mShim.At( i ) ) ) );
+      }
    };
 
    template< class V, class F >
@@ -402,14 +1165,73 @@ struct Shim : ShimBase< T >
                }
             }
          }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            return d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               auto ret = f( std::forward< decltype( v ) >( v ) );
+               if( UnwrapReferenceV( ret ) )
+               {
+                  return s( ConvertV< V >( *UnwrapReferenceV( std::move( ret ) ) ) );
+               }
+               return true;
+            } );
+         }
+
+         static constexpr bool BatchPreferred = simd::IsFilterMap< std::decay_t< F >, DecayValueType >::value && std::is_same< V, DecayValueType >::value &&
+                                                IsBatchPreferred< typename DecayT::Iterator >::value;
+
+         template< class B >
+         size_t NextBatch( B& b ) const
+         {
+            if constexpr( BatchPreferred )
+            {
+               Batch< ValueType, B::Capacity > batch;
+               DecayValueType buffer[ B::Capacity ];
+               b.Clear();
+               while( auto size = d::NextBatch( this->mIterator, batch ) )
+               {
+                  auto count = simd::FilterMap( LaneData( batch, buffer ), size, mOwner->mFunctor, b.Data() );
+                  b.Commit( count );
+                  if( count != 0 )
+                  {
+                     break;
+                  }
+               }
+               return b.Size();
+            }
+            else
+            {
+               return FillBatch( *this, b );
+            }
+         }
       };
 
       F mFunctor;
 
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Filter();
+      }
+
       Iterator CreateIterator() const
       {
          return { { this->mShim.CreateIterator() }, this };
       };
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Partitioning GetPartitioning() const
+      {
+         return this->mShim.GetPartitioning();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Iterator CreateIterator( size_t begin, size_t end ) const
+      {
+         return { { this->mShim.CreateIterator( begin, end ) }, this };
+      };
    };
 
    template< class V, class F >
@@ -470,14 +1292,57 @@ struct Shim : ShimBase< T >
             }
             return {};
          }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto sink = [ & ]( auto&& v ) -> bool { return s( ConvertV< V >( std::forward< decltype( v ) >( v ) ) ); };
+            if( mManyIterator.is_initialized() && !d::ForEach( mManyIterator.value(), sink ) )
+            {
+               return false;
+            }
+
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            auto ret = d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               mManyResult.emplace( f( std::forward< decltype( v ) >( v ) ) );
+               mManyContainer.emplace( From( UnwrapReferenceV( std::move( mManyResult ).value() ) ) );
+               mManyIterator.emplace( mManyContainer.value().mShim.CreateIterator() );
+               return d::ForEach( mManyIterator.value(), sink );
+            } );
+
+            if( ret )
+            {
+               mManyIterator.reset();
+               mManyContainer.reset();
+               mManyResult.reset();
+            }
+            return ret;
+         }
       };
 
       F mFunctor;
 
+      SizeHint GetSizeHint() const
+      {
+         return SizeHint::Unknown();
+      }
+
       Iterator CreateIterator() const
       {
          return { { this->mShim.CreateIterator() }, this };
       };
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Partitioning GetPartitioning() const
+      {
+         return this->mShim.GetPartitioning();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Iterator CreateIterator( size_t begin, size_t end ) const
+      {
+         return { { this->mShim.CreateIterator( begin, end ) }, this };
+      };
    };
 
    template< class V, class F >
@@ -492,45 +1357,124 @@ struct Shim : ShimBase< T >
       return { { { { { std::forward< T >( this->mShim ) } }, std::forward< F >( f ) } } };
    }
 
-   // Concat
-   template< class T2 >
-   struct ConcatShim : ShimBase< T >
+   // SelectMany( delimiters )
+   struct SplitManyShim : ShimBase< T >
    {
       struct Iterator : ShimIt< typename DecayT::Iterator >
       {
-         using base = ShimIt< typename DecayT::Iterator >;
-
-         const ConcatShim* mOwner;
-
-         mutable bool mFlag = {};
-
-         using RhsIterator = decltype( mOwner->mConcatContainer.mShim.CreateIterator() );
-         mutable optional< RhsIterator > mRhsIterator;
+         using ResultType = optional< std::string_view >;
 
-         using R1 = typename base::ResultType;
-         using R2 = typename RhsIterator::ResultType;
-         using V1 = typename R1::value_type;
-         using V2 = typename R2::value_type;
+         const SplitManyShim* mOwner;
 
-         using ResultType = std::conditional_t<
-            !std::is_reference< V1 >::value, R1,
-            std::conditional_t<
-               !std::is_reference< V2 >::value, R2,
-               std::conditional_t< std::is_const<
-                                      std::remove_reference_t< V1 > >::value,
-                                   R1, R2 > > >;
+         // Holds an element that isn't a reference while its tokens are taken.
+         mutable typename DecayT::Iterator::ResultType mElement;
+         mutable Splitter mSplitter;
 
          ResultType Next() const
          {
-            if( !mFlag )
+            for( ;; )
             {
-               auto result = this->mIterator.Next();
+               auto result = mSplitter.Next();
                if( result.is_initialized() )
                {
-                  return std::move( result ).value();
+                  return result;
                }
-               mFlag = true;
-               mRhsIterator.emplace( mOwner->mConcatContainer.mShim.CreateIterator() );
+               mElement = this->mIterator.Next();
+               if( !mElement.is_initialized() )
+               {
+                  return {};
+               }
+               mSplitter = Splitter{ std::string_view( mElement.value() ), mOwner->mDelimiters };
+            }
+         }
+      };
+
+      std::string mDelimiters;
+
+      SizeHint GetSizeHint() const
+      {
+         return SizeHint::Unknown();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this };
+      };
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Partitioning GetPartitioning() const
+      {
+         return this->mShim.GetPartitioning();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Iterator CreateIterator( size_t begin, size_t end ) const
+      {
+         return { { this->mShim.CreateIterator( begin, end ) }, this };
+      };
+   };
+
+   // The tokens of every element, a string or a string_view, as Split() finds them. The views point into the elements,
+   // which stay alive until the iteration moves to the next one when they aren't references.
+   Shim< SplitManyShim > SelectMany( char delimiter ) const&
+   {
+      return { { { { { this->mShim } }, std::string( 1, delimiter ) } } };
+   }
+
+   Shim< SplitManyShim > SelectMany( char delimiter ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::string( 1, delimiter ) } } };
+   }
+
+   Shim< SplitManyShim > SelectMany( std::string_view delimiters ) const&
+   {
+      return { { { { { this->mShim } }, std::string( delimiters ) } } };
+   }
+
+   Shim< SplitManyShim > SelectMany( std::string_view delimiters ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::string( delimiters ) } } };
+   }
+
+   // Concat
+   template< class T2 >
+   struct ConcatShim : ShimBase< T >
+   {
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+
+         const ConcatShim* mOwner;
+
+         mutable bool mFlag = {};
+
+         using RhsIterator = decltype( mOwner->mConcatContainer.mShim.CreateIterator() );
+         mutable optional< RhsIterator > mRhsIterator;
+
+         using R1 = typename base::ResultType;
+         using R2 = typename RhsIterator::ResultType;
+         using V1 = typename R1::value_type;
+         using V2 = typename R2::value_type;
+
+         using ResultType = std::conditional_t<
+            !std::is_reference< V1 >::value, R1,
+            std::conditional_t<
+               !std::is_reference< V2 >::value, R2,
+               std::conditional_t< std::is_const<
+                                      std::remove_reference_t< V1 > >::value,
+                                   R1, R2 > > >;
+
+         ResultType Next() const
+         {
+            if( !mFlag )
+            {
+               auto result = this->mIterator.Next();
+               if( result.is_initialized() )
+               {
+                  return std::move( result ).value();
+               }
+               mFlag = true;
+               mRhsIterator.emplace( mOwner->mConcatContainer.mShim.CreateIterator() );
             }
 
             {
@@ -543,6 +1487,22 @@ struct Shim : ShimBase< T >
 
             return {};
          }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto sink = [ & ]( auto&& v ) -> bool { return s( ConvertV< typename ResultType::value_type >( std::forward< decltype( v ) >( v ) ) ); };
+            if( !mFlag )
+            {
+               if( !d::ForEach( this->mIterator, sink ) )
+               {
+                  return false;
+               }
+               mFlag = true;
+               mRhsIterator.emplace( mOwner->mConcatContainer.mShim.CreateIterator() );
+            }
+            return d::ForEach( mRhsIterator.value(), sink );
+         }
       };
 
       T2 mContainer;
@@ -555,9 +1515,9 @@ struct Shim : ShimBase< T >
          return { { this->mShim.CreateIterator() }, this };
       };
 
-      size_t GetCapacity() const
+      SizeHint GetSizeHint() const
       {
-         return this->mShim.GetCapacity() + mConcatContainer.mShim.GetCapacity();
+         return this->mShim.GetSizeHint() + mConcatContainer.mShim.GetSizeHint();
       }
    };
 
@@ -574,158 +1534,354 @@ struct Shim : ShimBase< T >
    }
 
    // ExcludeIntersect
+   // The set of the second sequence is built by the first CreateIterator() and shared by the copies of the shim. A large
+   // set gets a Bloom filter in front of it, which answers most misses without touching the table. A HashIndex or a
+   // SortedIndex is probed as it is.
    template< typename T2, typename F, bool Exclude >
    struct ExcludeIntersectShim : ShimBase< T >
    {
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      using Inner = decltype( From( std::declval< T2 >() ) );
+      using Key = typename Inner::DecayValueType;
+      using Table = FlatHashMap< Key, bool, Hash< Key >, std::equal_to<>, Allocator< std::pair< Key, bool > > >;
+
+      static constexpr bool Prebuilt = IsIndex< std::decay_t< T2 > >::value;
+
+      struct Keys
+      {
+         explicit Keys( const typename Table::AllocatorType& a )
+            : mTable( a )
+            , mBloom( Prefilter( mTable ) )
+         {
+         }
+
+         std::once_flag mOnce;
+         Table mTable;
+         decltype( Prefilter( mTable ) ) mBloom;
+
+         template< class X >
+         bool Contains( const X& key ) const
+         {
+            return Probe( mTable, mBloom, key ) != nullptr;
+         }
+      };
+
+      using Set = std::conditional_t< Prebuilt, std::decay_t< T2 >, Keys >;
+
       struct Iterator : ShimIt< typename DecayT::Iterator >
       {
          using base = ShimIt< typename DecayT::Iterator >;
          using ResultType = typename base::ResultType;
 
          const ExcludeIntersectShim* mOwner;
+         const Set* mKeys;
 
          ResultType Next() const
          {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
             for( ;; )
             {
                auto result = this->mIterator.Next();
-               if( result.is_initialized() )
+               if( !result.is_initialized() )
                {
-                  auto it = mOwner->mExcludeIntersectSet.find( const_cast< F& >( mOwner->mFunctor )( result.value() ) );
-                  if constexpr( Exclude )
-                  {
-                     if( it == mOwner->mExcludeIntersectSet.end() )
-                     {
-                        return result;
-                     }
-                  }
-                  else
-                  {
-                     if( it != mOwner->mExcludeIntersectSet.end() )
-                     {
-                        return result;
-                     }
-                  }
+                  return {};
                }
-               else
+               if( mKeys->Contains( f( result.value() ) ) != Exclude )
                {
-                  break;
+                  return result;
                }
             }
-            return {};
+         }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            auto& keys = *mKeys;
+            return d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               if( keys.Contains( f( v ) ) != Exclude )
+               {
+                  return s( std::forward< decltype( v ) >( v ) );
+               }
+               return true;
+            } );
          }
       };
 
-      constexpr ExcludeIntersectShim( T&& t, T2&& t2, F&& f )
-         : ShimBase< T >{ std::forward< T >( t ) }
-         , mFunctor{ std::forward< F >( f ) }
-         , mExcludeIntersectSet{ From( std::forward< T2 >( t2 ) ).ToUnorderedSet() }
+      T2 mContainer;
+      F mFunctor;
+      std::shared_ptr< Keys > mKeys = MakeKeys();
+      Inner mInner = From( std::forward< T2 >( mContainer ) );
+
+      std::shared_ptr< Keys > MakeKeys() const
+      {
+         if constexpr( Prebuilt )
+         {
+            return nullptr;
+         }
+         else
+         {
+            return std::allocate_shared< Keys >( this->template GetAllocator< Keys >(), this->template GetAllocator< typename Table::Entry >() );
+         }
+      }
+
+      const Set& GetKeys() const
       {
+         if constexpr( Prebuilt )
+         {
+            return mInner.mShim.mContainer;
+         }
+         else
+         {
+            std::call_once( mKeys->mOnce, [ & ] {
+               auto& table = mKeys->mTable;
+               table.Reserve( mInner.GetCapacity() );
+               Index( table, mInner.mShim.CreateIterator(), sort::Identity{}, []( bool&, auto&& ) {} );
+               mKeys->mBloom = Prefilter( table );
+            } );
+            return *mKeys;
+         }
       }
 
-      F mFunctor;
-      decltype( From( std::declval< T2 >() ).ToUnorderedSet() ) mExcludeIntersectSet;
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Filter();
+      }
 
       Iterator CreateIterator() const
       {
-         return { { this->mShim.CreateIterator() }, this };
+         return { { this->mShim.CreateIterator() }, this, &GetKeys() };
       };
    };
 
    template< typename T2, typename F >
    Shim< ExcludeIntersectShim< T2, F, true > > Exclude( T2&& t, F&& f ) const&
    {
-      return { { { this->mShim, std::forward< T2 >( t ), std::forward< F >( f ) } } };
+      return { { { { { this->mShim } }, std::forward< T2 >( t ), std::forward< F >( f ) } } };
    }
 
    template< typename T2, typename F >
    Shim< ExcludeIntersectShim< T2, F, true > > Exclude( T2&& t, F&& f ) &&
    {
-      return { { { std::forward< T >( this->mShim ), std::forward< T2 >( t ), std::forward< F >( f ) } } };
+      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< T2 >( t ), std::forward< F >( f ) } } };
    }
 
    template< typename T2 >
    auto Exclude( T2&& t ) const&
    {
-      return Exclude( std::forward< T2 >( t ), []( auto&& m ) { return m; } );
+      return Exclude( std::forward< T2 >( t ), sort::Identity{} );
    }
 
    template< typename T2 >
    auto Exclude( T2&& t ) &&
    {
-      return std::move( *this ).Exclude( std::forward< T2 >( t ), []( auto&& m ) { return m; } );
+      return std::move( *this ).Exclude( std::forward< T2 >( t ), sort::Identity{} );
    }
 
    template< typename T2, typename F >
    Shim< ExcludeIntersectShim< T2, F, false > > Intersect( T2&& t, F&& f ) const&
    {
-      return { { { this->mShim, std::forward< T2 >( t ), std::forward< F >( f ) } } };
+      return { { { { { this->mShim } }, std::forward< T2 >( t ), std::forward< F >( f ) } } };
    }
 
    template< typename T2, typename F >
    Shim< ExcludeIntersectShim< T2, F, false > > Intersect( T2&& t, F&& f ) &&
    {
-      return { { { std::forward< T >( this->mShim ), std::forward< T2 >( t ), std::forward< F >( f ) } } };
+      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< T2 >( t ), std::forward< F >( f ) } } };
    }
 
    template< typename T2 >
    auto Intersect( T2&& t ) const&
    {
-      return Intersect( std::forward< T2 >( t ), []( auto&& m ) { return m; } );
+      return Intersect( std::forward< T2 >( t ), sort::Identity{} );
    }
 
    template< typename T2 >
    auto Intersect( T2&& t ) &&
    {
-      return std::move( *this ).Intersect( std::forward< T2 >( t ), []( auto&& m ) { return m; } );
+      return std::move( *this ).Intersect( std::forward< T2 >( t ), sort::Identity{} );
    }
 
-   // Cast
-   template< class V >
-   auto Cast() const&
+   // Join
+   // Every enumeration builds a flat hash table of one side by key, then streams the other side through it. Join builds
+   // the outer side only when its size hint proves it smaller than the inner one; the results then come in the order of
+   // the inner side.
+   template< class T2, class OK, class IK, class RS >
+   struct JoinShim : ShimBase< T >
    {
-      return this->template Select< V >( []( auto&& m ) -> V { return static_cast< V >( m ); } );
+      using Inner = decltype( From( std::declval< T2 >() ) );
+      using InnerValueType = typename Inner::DecayValueType;
+      using Key = std::common_type_t< std::decay_t< std::invoke_result_t< OK&, const DecayValueType& > >,
+                                      std::decay_t< std::invoke_result_t< IK&, const InnerValueType& > > >;
+      using V = std::decay_t< std::invoke_result_t< RS&, const DecayValueType&, const InnerValueType& > >;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = optional< V >;
+         using InnerIterator = decltype( std::declval< const Inner& >().mShim.CreateIterator() );
+
+         const JoinShim* mOwner;
+         mutable bool mBuilt = false;
+         mutable bool mBuildInner = true;
+         mutable optional< InnerIterator > mInnerIterator;
+         mutable optional< FlatHashMap< Key, std::vector< InnerValueType > > > mInnerTable;
+         mutable optional< FlatHashMap< Key, std::vector< DecayValueType > > > mOuterTable;
+         mutable optional< typename base::ResultType > mOuter;
+         mutable optional< typename InnerIterator::ResultType > mInner;
+         mutable const std::vector< InnerValueType >* mInnerMatches = nullptr;
+         mutable const std::vector< DecayValueType >* mOuterMatches = nullptr;
+         mutable size_t mMatch = 0;
+
+         void Build() const
+         {
+            if( mBuilt )
+            {
+               return;
+            }
+            mBuilt = true;
+            auto outer = mOwner->mShim.GetSizeHint();
+            auto inner = mOwner->mInner.mShim.GetSizeHint();
+            mInnerIterator.emplace( mOwner->mInner.mShim.CreateIterator() );
+            mBuildInner = !( outer.mUpper < inner.mLower );
+            if( mBuildInner )
+            {
+               mInnerTable.emplace();
+               mInnerTable.value().Reserve( inner.Capacity( sizeof( InnerValueType ) ) );
+               Index( mInnerTable.value(), mInnerIterator.value(), const_cast< IK& >( mOwner->mInnerKey ), Append{} );
+            }
+            else
+            {
+               mOuterTable.emplace();
+               mOuterTable.value().Reserve( outer.Capacity( sizeof( DecayValueType ) ) );
+               Index( mOuterTable.value(), this->mIterator, const_cast< OK& >( mOwner->mOuterKey ), Append{} );
+            }
+         }
+
+         ResultType Next() const
+         {
+            Build();
+            auto& resultSelector = const_cast< RS& >( mOwner->mResultSelector );
+            for( ;; )
+            {
+               if( mBuildInner )
+               {
+                  if( mInnerMatches != nullptr && mMatch < mInnerMatches->size() )
+                  {
+                     return resultSelector( std::as_const( mOuter.value().value() ), ( *mInnerMatches )[ mMatch++ ] );
+                  }
+                  auto outer = this->mIterator.Next();
+                  if( !outer.is_initialized() )
+                  {
+                     return {};
+                  }
+                  mInnerMatches = mInnerTable.value().Find( const_cast< OK& >( mOwner->mOuterKey )( std::as_const( outer.value() ) ) );
+                  mMatch = 0;
+                  if( mInnerMatches != nullptr )
+                  {
+                     mOuter.emplace( std::move( outer ) );
+                  }
+               }
+               else
+               {
+                  if( mOuterMatches != nullptr && mMatch < mOuterMatches->size() )
+                  {
+                     return resultSelector( ( *mOuterMatches )[ mMatch++ ], std::as_const( mInner.value().value() ) );
+                  }
+                  auto inner = mInnerIterator.value().Next();
+                  if( !inner.is_initialized() )
+                  {
+                     return {};
+                  }
+                  mOuterMatches = mOuterTable.value().Find( const_cast< IK& >( mOwner->mInnerKey )( std::as_const( inner.value() ) ) );
+                  mMatch = 0;
+                  if( mOuterMatches != nullptr )
+                  {
+                     mInner.emplace( std::move( inner ) );
+                  }
+               }
+            }
+         }
+      };
+
+      T2 mContainer;
+      OK mOuterKey;
+      IK mInnerKey;
+      RS mResultSelector;
+      Inner mInner = From( std::forward< T2 >( mContainer ) );
+
+      SizeHint GetSizeHint() const
+      {
+         return SizeHint::Unknown();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this };
+      };
+   };
+
+   // resultSelector( outer, inner ) for every pair of elements with equal keys.
+   template< class T2, class OK, class IK, class RS >
+   Shim< JoinShim< T2, OK, IK, RS > > Join( T2&& inner, OK&& outerKey, IK&& innerKey, RS&& resultSelector ) const&
+   {
+      return { { { { { this->mShim } }, std::forward< T2 >( inner ), std::forward< OK >( outerKey ), std::forward< IK >( innerKey ), std::forward< RS >( resultSelector ) } } };
    }
 
-   template< class V >
-   auto Cast() &&
+   template< class T2, class OK, class IK, class RS >
+   Shim< JoinShim< T2, OK, IK, RS > > Join( T2&& inner, OK&& outerKey, IK&& innerKey, RS&& resultSelector ) &&
    {
-      return std::move( *this ).template Select< V >( []( auto&& m ) -> V { return static_cast< V >( m ); } );
+      return { { { { { std::forward< T >( this->mShim ) } },
+                     std::forward< T2 >( inner ),
+                     std::forward< OK >( outerKey ),
+                     std::forward< IK >( innerKey ),
+                     std::forward< RS >( resultSelector ) } } };
    }
 
-   // Until
-   template< class F >
-   struct UntilShim : ShimBase< T >
+   // GroupJoin
+   template< class T2, class OK, class IK, class RS >
+   struct GroupJoinShim : ShimBase< T >
    {
+      using Inner = decltype( From( std::declval< T2 >() ) );
+      using InnerValueType = typename Inner::DecayValueType;
+      using Key = std::common_type_t< std::decay_t< std::invoke_result_t< OK&, const DecayValueType& > >,
+                                      std::decay_t< std::invoke_result_t< IK&, const InnerValueType& > > >;
+      using V = std::decay_t< std::invoke_result_t< RS&, const DecayValueType&, const std::vector< InnerValueType >& > >;
+
       struct Iterator : ShimIt< typename DecayT::Iterator >
       {
          using base = ShimIt< typename DecayT::Iterator >;
-         using ResultType = typename base::ResultType;
-
-         const UntilShim* mOwner;
+         using ResultType = optional< V >;
 
-         mutable bool mBreak = {};
+         const GroupJoinShim* mOwner;
+         mutable optional< FlatHashMap< Key, std::vector< InnerValueType > > > mTable;
 
          ResultType Next() const
          {
-            if( mBreak )
+            if( !mTable.is_initialized() )
             {
-               return {};
+               mTable.emplace();
+               mTable.value().Reserve( mOwner->mInner.GetCapacity() );
+               Index( mTable.value(), mOwner->mInner.mShim.CreateIterator(), const_cast< IK& >( mOwner->mInnerKey ), Append{} );
             }
-            auto result = this->mIterator.Next();
-            if( result.is_initialized() )
+            auto outer = this->mIterator.Next();
+            if( !outer.is_initialized() )
             {
-               if( !const_cast< F& >( mOwner->mFunctor )( result.value() ) )
-               {
-                  return result;
-               }
+               return {};
             }
-            mBreak = true;
-            return {};
+            static const std::vector< InnerValueType > none;
+            auto& value = std::as_const( outer.value() );
+            auto matches = mTable.value().Find( const_cast< OK& >( mOwner->mOuterKey )( value ) );
+            return const_cast< RS& >( mOwner->mResultSelector )( value, matches != nullptr ? *matches : none );
          }
       };
 
-      F mFunctor;
+      T2 mContainer;
+      OK mOuterKey;
+      IK mInnerKey;
+      RS mResultSelector;
+      Inner mInner = From( std::forward< T2 >( mContainer ) );
 
       Iterator CreateIterator() const
       {
@@ -733,40 +1889,1323 @@ struct Shim : ShimBase< T >
       };
    };
 
-   template< class F >
-   Shim< UntilShim< F > > Until( F&& f ) const&
+   // resultSelector( outer, std::vector of the matching inner elements ) for every outer element, in the outer order.
+   template< class T2, class OK, class IK, class RS >
+   Shim< GroupJoinShim< T2, OK, IK, RS > > GroupJoin( T2&& inner, OK&& outerKey, IK&& innerKey, RS&& resultSelector ) const&
    {
-      return { { { { { this->mShim } }, std::forward< F >( f ) } } };
+      return { { { { { this->mShim } }, std::forward< T2 >( inner ), std::forward< OK >( outerKey ), std::forward< IK >( innerKey ), std::forward< RS >( resultSelector ) } } };
    }
 
-   template< class F >
-   Shim< UntilShim< F > > Until( F&& f ) &&
+   template< class T2, class OK, class IK, class RS >
+   Shim< GroupJoinShim< T2, OK, IK, RS > > GroupJoin( T2&& inner, OK&& outerKey, IK&& innerKey, RS&& resultSelector ) &&
    {
-      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< F >( f ) } } };
+      return { { { { { std::forward< T >( this->mShim ) } },
+                     std::forward< T2 >( inner ),
+                     std::forward< OK >( outerKey ),
+                     std::forward< IK >( innerKey ),
+                     std::forward< RS >( resultSelector ) } } };
    }
 
-   // Take
-   auto Take( size_t count ) const&
+   // SemiJoin
+   template< class T2, class OK, class IK, bool Anti >
+   struct SemiJoinShim : ShimBase< T >
    {
-      return this->Until( [ count ]( const auto& ) mutable { return count-- == 0; } );
-   }
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      using Inner = decltype( From( std::declval< T2 >() ) );
+      using Key = std::common_type_t< std::decay_t< std::invoke_result_t< OK&, const DecayValueType& > >,
+                                      std::decay_t< std::invoke_result_t< IK&, const typename Inner::DecayValueType& > > >;
+      using Table = FlatHashMap< Key, bool >;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = typename base::ResultType;
+
+         const SemiJoinShim* mOwner;
+         mutable optional< Table > mTable;
+
+         const Table& Keys() const
+         {
+            if( !mTable.is_initialized() )
+            {
+               mTable.emplace();
+               mTable.value().Reserve( mOwner->mInner.GetCapacity() );
+               Index( mTable.value(), mOwner->mInner.mShim.CreateIterator(), const_cast< IK& >( mOwner->mInnerKey ), []( bool&, auto&& ) {} );
+            }
+            return mTable.value();
+         }
+
+         ResultType Next() const
+         {
+            auto& keys = Keys();
+            auto& outerKey = const_cast< OK& >( mOwner->mOuterKey );
+            for( ;; )
+            {
+               auto result = this->mIterator.Next();
+               if( !result.is_initialized() )
+               {
+                  return {};
+               }
+               if( ( keys.Find( outerKey( std::as_const( result.value() ) ) ) == nullptr ) == Anti )
+               {
+                  return result;
+               }
+            }
+         }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto& keys = Keys();
+            auto& outerKey = const_cast< OK& >( mOwner->mOuterKey );
+            return d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               if( ( keys.Find( outerKey( std::as_const( v ) ) ) == nullptr ) == Anti )
+               {
+                  return s( std::forward< decltype( v ) >( v ) );
+               }
+               return true;
+            } );
+         }
+      };
+
+      T2 mContainer;
+      OK mOuterKey;
+      IK mInnerKey;
+      Inner mInner = From( std::forward< T2 >( mContainer ) );
+
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Filter();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this };
+      };
+   };
+
+   // The outer elements with a matching inner element.
+   template< class T2, class OK, class IK >
+   Shim< SemiJoinShim< T2, OK, IK, false > > SemiJoin( T2&& inner, OK&& outerKey, IK&& innerKey ) const&
+   {
+      return { { { { { this->mShim } }, std::forward< T2 >( inner ), std::forward< OK >( outerKey ), std::forward< IK >( innerKey ) } } };
+   }
+
+   template< class T2, class OK, class IK >
+   Shim< SemiJoinShim< T2, OK, IK, false > > SemiJoin( T2&& inner, OK&& outerKey, IK&& innerKey ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< T2 >( inner ), std::forward< OK >( outerKey ), std::forward< IK >( innerKey ) } } };
+   }
+
+   // The outer elements without a matching inner element.
+   template< class T2, class OK, class IK >
+   Shim< SemiJoinShim< T2, OK, IK, true > > AntiJoin( T2&& inner, OK&& outerKey, IK&& innerKey ) const&
+   {
+      return { { { { { this->mShim } }, std::forward< T2 >( inner ), std::forward< OK >( outerKey ), std::forward< IK >( innerKey ) } } };
+   }
+
+   template< class T2, class OK, class IK >
+   Shim< SemiJoinShim< T2, OK, IK, true > > AntiJoin( T2&& inner, OK&& outerKey, IK&& innerKey ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< T2 >( inner ), std::forward< OK >( outerKey ), std::forward< IK >( innerKey ) } } };
+   }
+
+   // IndexJoin
+   template< class T2, class OK, class RS >
+   struct IndexJoinShim : ShimBase< T >
+   {
+      using IndexType = std::decay_t< T2 >;
+      using InnerValueType = typename IndexType::Value;
+      using V = std::decay_t< std::invoke_result_t< RS&, const DecayValueType&, const InnerValueType& > >;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = optional< V >;
+
+         const IndexJoinShim* mOwner;
+         mutable optional< typename base::ResultType > mOuter;
+         mutable typename IndexType::Range mMatches;
+         mutable const InnerValueType* mMatch = nullptr;
+
+         ResultType Next() const
+         {
+            for( ;; )
+            {
+               if( mMatch != mMatches.end() )
+               {
+                  return const_cast< RS& >( mOwner->mResultSelector )( std::as_const( mOuter.value().value() ), *mMatch++ );
+               }
+               auto outer = this->mIterator.Next();
+               if( !outer.is_initialized() )
+               {
+                  return {};
+               }
+               mMatches = mOwner->mIndex.Find( const_cast< OK& >( mOwner->mOuterKey )( std::as_const( outer.value() ) ) );
+               mMatch = mMatches.begin();
+               if( !mMatches.empty() )
+               {
+                  mOuter.emplace( std::move( outer ) );
+               }
+            }
+         }
+      };
+
+      T2 mIndex;
+      OK mOuterKey;
+      RS mResultSelector;
+
+      SizeHint GetSizeHint() const
+      {
+         return SizeHint::Unknown();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this };
+      };
+   };
+
+   // Join(), GroupJoin(), SemiJoin() and AntiJoin() against a prebuilt HashIndex or SortedIndex, whose keys are the inner
+   // keys. GroupJoin() passes the matching elements as a range of the index.
+   template< class T2, class OK, class RS, std::enable_if_t< IsIndex< std::decay_t< T2 > >::value, int > = 0 >
+   Shim< IndexJoinShim< T2, OK, RS > > Join( T2&& index, OK&& outerKey, RS&& resultSelector ) const&
+   {
+      return { { { { { this->mShim } }, std::forward< T2 >( index ), std::forward< OK >( outerKey ), std::forward< RS >( resultSelector ) } } };
+   }
+
+   template< class T2, class OK, class RS, std::enable_if_t< IsIndex< std::decay_t< T2 > >::value, int > = 0 >
+   Shim< IndexJoinShim< T2, OK, RS > > Join( T2&& index, OK&& outerKey, RS&& resultSelector ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< T2 >( index ), std::forward< OK >( outerKey ), std::forward< RS >( resultSelector ) } } };
+   }
+
+   template< class T2, class OK, class RS, std::enable_if_t< IsIndex< std::decay_t< T2 > >::value, int > = 0 >
+   auto GroupJoin( T2&& index, OK&& outerKey, RS&& resultSelector ) const&
+   {
+      auto copy = *this;
+      return std::move( copy ).GroupJoin( std::forward< T2 >( index ), std::forward< OK >( outerKey ), std::forward< RS >( resultSelector ) );
+   }
+
+   template< class T2, class OK, class RS, std::enable_if_t< IsIndex< std::decay_t< T2 > >::value, int > = 0 >
+   auto GroupJoin( T2&& index, OK&& outerKey, RS&& resultSelector ) &&
+   {
+      using Range = typename std::decay_t< T2 >::Range;
+      using V = std::decay_t< std::invoke_result_t< RS&, const DecayValueType&, const Range& > >;
+      return std::move( *this ).template Select< V >(
+         [ index = std::decay_t< T2 >( index ), outerKey = std::forward< OK >( outerKey ), resultSelector = std::forward< RS >( resultSelector ) ](
+            const DecayValueType& m ) mutable { return resultSelector( m, index.Find( outerKey( m ) ) ); } );
+   }
+
+   template< class T2, class OK, std::enable_if_t< IsIndex< std::decay_t< T2 > >::value, int > = 0 >
+   auto SemiJoin( T2&& index, OK&& outerKey ) const&
+   {
+      return Intersect( std::forward< T2 >( index ), std::forward< OK >( outerKey ) );
+   }
+
+   template< class T2, class OK, std::enable_if_t< IsIndex< std::decay_t< T2 > >::value, int > = 0 >
+   auto SemiJoin( T2&& index, OK&& outerKey ) &&
+   {
+      return std::move( *this ).Intersect( std::forward< T2 >( index ), std::forward< OK >( outerKey ) );
+   }
+
+   template< class T2, class OK, std::enable_if_t< IsIndex< std::decay_t< T2 > >::value, int > = 0 >
+   auto AntiJoin( T2&& index, OK&& outerKey ) const&
+   {
+      return Exclude( std::forward< T2 >( index ), std::forward< OK >( outerKey ) );
+   }
+
+   template< class T2, class OK, std::enable_if_t< IsIndex< std::decay_t< T2 > >::value, int > = 0 >
+   auto AntiJoin( T2&& index, OK&& outerKey ) &&
+   {
+      return std::move( *this ).Exclude( std::forward< T2 >( index ), std::forward< OK >( outerKey ) );
+   }
+
+   // MergeJoin
+   // Both sides must be sorted by their keys in ascending order. The two sides advance together; only the inner elements
+   // sharing the current key are buffered, so the memory is O( longest run of equal inner keys ).
+   template< class T2, class OK, class IK, class RS >
+   struct MergeJoinShim : ShimBase< T >
+   {
+      using Inner = decltype( From( std::declval< T2 >() ) );
+      using InnerValueType = typename Inner::DecayValueType;
+      using Key = std::common_type_t< std::decay_t< std::invoke_result_t< OK&, const DecayValueType& > >,
+                                      std::decay_t< std::invoke_result_t< IK&, const InnerValueType& > > >;
+      using V = std::decay_t< std::invoke_result_t< RS&, const DecayValueType&, const InnerValueType& > >;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = optional< V >;
+         using InnerIterator = decltype( std::declval< const Inner& >().mShim.CreateIterator() );
+
+         const MergeJoinShim* mOwner;
+         InnerIterator mInnerIterator;
+         mutable bool mStarted = false;
+         mutable optional< typename base::ResultType > mOuter;
+         mutable optional< InnerValueType > mPending;
+         mutable optional< Key > mRunKey;
+         mutable std::vector< InnerValueType > mRun;
+         mutable size_t mMatch = 0;
+
+         void Pull() const
+         {
+            auto result = mInnerIterator.Next();
+            if( result.is_initialized() )
+            {
+               mPending.emplace( std::move( result ).value() );
+            }
+            else
+            {
+               mPending.reset();
+            }
+         }
+
+         // Buffers the inner elements with the key, skipping the smaller ones; false when there are none.
+         bool Seek( const Key& key ) const
+         {
+            auto& innerKey = const_cast< IK& >( mOwner->mInnerKey );
+            if( mRunKey.is_initialized() && !( mRunKey.value() < key ) && !( key < mRunKey.value() ) )
+            {
+               return !mRun.empty();
+            }
+            mRun.clear();
+            mRunKey.emplace( key );
+            while( mPending.is_initialized() && innerKey( std::as_const( mPending.value() ) ) < key )
+            {
+               Pull();
+            }
+            while( mPending.is_initialized() && !( key < innerKey( std::as_const( mPending.value() ) ) ) )
+            {
+               mRun.push_back( std::move( mPending.value() ) );
+               Pull();
+            }
+            return !mRun.empty();
+         }
+
+         ResultType Next() const
+         {
+            if( !mStarted )
+            {
+               mStarted = true;
+               Pull();
+            }
+            for( ;; )
+            {
+               if( mOuter.is_initialized() && mMatch < mRun.size() )
+               {
+                  return const_cast< RS& >( mOwner->mResultSelector )( std::as_const( mOuter.value().value() ), std::as_const( mRun[ mMatch++ ] ) );
+               }
+               auto outer = this->mIterator.Next();
+               if( !outer.is_initialized() )
+               {
+                  return {};
+               }
+               mMatch = 0;
+               mOuter.reset();
+               if( Seek( const_cast< OK& >( mOwner->mOuterKey )( std::as_const( outer.value() ) ) ) )
+               {
+                  mOuter.emplace( std::move( outer ) );
+               }
+               else if( !mPending.is_initialized() )
+               {
+                  return {};
+               }
+            }
+         }
+      };
+
+      T2 mContainer;
+      OK mOuterKey;
+      IK mInnerKey;
+      RS mResultSelector;
+      Inner mInner = From( std::forward< T2 >( mContainer ) );
+
+      SizeHint GetSizeHint() const
+      {
+         return SizeHint::Unknown();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this, mInner.mShim.CreateIterator() };
+      };
+   };
+
+   template< class T2, class OK, class IK, class RS >
+   Shim< MergeJoinShim< T2, OK, IK, RS > > MergeJoin( T2&& inner, OK&& outerKey, IK&& innerKey, RS&& resultSelector ) const&
+   {
+      return { { { { { this->mShim } }, std::forward< T2 >( inner ), std::forward< OK >( outerKey ), std::forward< IK >( innerKey ), std::forward< RS >( resultSelector ) } } };
+   }
+
+   template< class T2, class OK, class IK, class RS >
+   Shim< MergeJoinShim< T2, OK, IK, RS > > MergeJoin( T2&& inner, OK&& outerKey, IK&& innerKey, RS&& resultSelector ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } },
+                     std::forward< T2 >( inner ),
+                     std::forward< OK >( outerKey ),
+                     std::forward< IK >( innerKey ),
+                     std::forward< RS >( resultSelector ) } } };
+   }
+
+   // MergeSorted
+   // A k-way merge of sorted sources through a loser tree: every element costs log2( k ) comparisons and the memory is
+   // one element per source. Equal elements come in the order of the sources.
+   template< class... T2 >
+   struct MergeSortedShim : ShimBase< T >
+   {
+      static constexpr size_t K = 1 + sizeof...( T2 );
+
+      using Sources = std::tuple< decltype( From( std::declval< T2 >() ) )... >;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = optional< DecayValueType >;
+
+         const MergeSortedShim* mOwner;
+         std::tuple< decltype( std::declval< decltype( From( std::declval< T2 >() ) ) >().mShim.CreateIterator() )... > mIterators;
+         mutable bool mStarted = false;
+         mutable std::array< optional< DecayValueType >, K > mHeads;
+         // mTree[ 0 ] is the winner, mTree[ 1 ] ... mTree[ K - 1 ] the losers of the inner nodes; leaf i is node K + i.
+         mutable std::array< size_t, K > mTree;
+
+         template< size_t I >
+         void Pull() const
+         {
+            auto result = [ & ] {
+               if constexpr( I == 0 )
+               {
+                  return this->mIterator.Next();
+               }
+               else
+               {
+                  return std::get< I - 1 >( mIterators ).Next();
+               }
+            }();
+            if( result.is_initialized() )
+            {
+               mHeads[ I ].emplace( std::move( result ).value() );
+            }
+            else
+            {
+               mHeads[ I ].reset();
+            }
+         }
+
+         template< size_t... I >
+         void Pull( size_t i, std::index_sequence< I... > ) const
+         {
+            static_cast< void >( ( ( i == I ? ( Pull< I >(), true ) : false ) || ... ) );
+         }
+
+         // Whether source a goes before source b; exhausted sources go last.
+         bool Before( size_t a, size_t b ) const
+         {
+            if( !mHeads[ a ].is_initialized() )
+            {
+               return false;
+            }
+            if( !mHeads[ b ].is_initialized() )
+            {
+               return true;
+            }
+            if( mHeads[ a ].value() < mHeads[ b ].value() )
+            {
+               return true;
+            }
+            return !( mHeads[ b ].value() < mHeads[ a ].value() ) && a < b;
+         }
+
+         size_t Build( size_t node ) const
+         {
+            if( node >= K )
+            {
+               return node - K;
+            }
+            auto a = Build( 2 * node );
+            auto b = Build( 2 * node + 1 );
+            if( Before( a, b ) )
+            {
+               std::swap( a, b );
+            }
+            mTree[ node ] = a;
+            return b;
+         }
+
+         void Replay( size_t i ) const
+         {
+            auto winner = i;
+            for( auto node = ( K + i ) / 2; node > 0; node /= 2 )
+            {
+               if( Before( mTree[ node ], winner ) )
+               {
+                  std::swap( mTree[ node ], winner );
+               }
+            }
+            mTree[ 0 ] = winner;
+         }
+
+         ResultType Next() const
+         {
+            if( !mStarted )
+            {
+               mStarted = true;
+               for( size_t i = 0; i < K; ++i )
+               {
+                  Pull( i, std::make_index_sequence< K >() );
+               }
+               mTree[ 0 ] = K == 1 ? 0 : Build( 1 );
+            }
+            auto winner = mTree[ 0 ];
+            if( !mHeads[ winner ].is_initialized() )
+            {
+               return {};
+            }
+            ResultType ret{ std::move( mHeads[ winner ] ).value() };
+            Pull( winner, std::make_index_sequence< K >() );
+            Replay( winner );
+            return ret;
+         }
+      };
+
+      std::tuple< T2... > mContainers;
+      Sources mSources = std::apply( []( auto&&... c ) { return Sources{ From( std::forward< T2 >( c ) )... }; }, mContainers );
+
+      SizeHint GetSizeHint() const
+      {
+         return std::apply( [ & ]( auto&... s ) { return ( this->mShim.GetSizeHint() + ... + s.mShim.GetSizeHint() ); }, mSources );
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this, std::apply( []( auto&... s ) { return std::make_tuple( s.mShim.CreateIterator()... ); }, mSources ) };
+      };
+   };
+
+   template< class... T2 >
+   Shim< MergeSortedShim< T2... > > MergeSorted( T2&&... sources ) const&
+   {
+      return { { { { { this->mShim } }, { std::forward< T2 >( sources )... } } } };
+   }
+
+   template< class... T2 >
+   Shim< MergeSortedShim< T2... > > MergeSorted( T2&&... sources ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, { std::forward< T2 >( sources )... } } } };
+   }
+
+   // Cast
+   template< class V >
+   auto Cast() const&
+   {
+      return this->template Select< V >( []( auto&& m ) -> V { return static_cast< V >( m ); } );
+   }
+
+   template< class V >
+   auto Cast() &&
+   {
+      return std::move( *this ).template Select< V >( []( auto&& m ) -> V { return static_cast< V >( m ); } );
+   }
+
+   // Until
+   template< class F >
+   struct UntilShim : ShimBase< T >
+   {
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = typename base::ResultType;
+
+         const UntilShim* mOwner;
+
+         mutable bool mBreak = {};
+
+         ResultType Next() const
+         {
+            if( mBreak )
+            {
+               return {};
+            }
+            auto result = this->mIterator.Next();
+            if( result.is_initialized() )
+            {
+               if( !const_cast< F& >( mOwner->mFunctor )( result.value() ) )
+               {
+                  return result;
+               }
+            }
+            mBreak = true;
+            return {};
+         }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            if( mBreak )
+            {
+               return true;
+            }
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            auto ret = d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               if( f( v ) )
+               {
+                  mBreak = true;
+                  return false;
+               }
+               return s( std::forward< decltype( v ) >( v ) );
+            } );
+            if( ret )
+            {
+               mBreak = true;
+            }
+            return mBreak;
+         }
+      };
+
+      F mFunctor;
+
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Filter();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this };
+      };
+   };
+
+   template< class F >
+   Shim< UntilShim< F > > Until( F&& f ) const&
+   {
+      return { { { { { this->mShim } }, std::forward< F >( f ) } } };
+   }
+
+   template< class F >
+   Shim< UntilShim< F > > Until( F&& f ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< F >( f ) } } };
+   }
+
+   // AsParallel
+   struct ParallelShim : ShimBase< T >
+   {
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = typename base::ResultType;
+
+         mutable size_t mRemaining;
+
+         ResultType Next() const
+         {
+            if( mRemaining == 0 )
+            {
+               return {};
+            }
+            --mRemaining;
+            return this->mIterator.Next();
+         }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            if( mRemaining == 0 )
+            {
+               return true;
+            }
+            auto stopped = false;
+            d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               --mRemaining;
+               if( !s( std::forward< decltype( v ) >( v ) ) )
+               {
+                  stopped = true;
+                  return false;
+               }
+               return mRemaining != 0;
+            } );
+            return !stopped;
+         }
+
+         void Advance( size_t n ) const
+         {
+            n = std::min( n, mRemaining );
+            d::Advance( this->mIterator, n );
+            mRemaining -= n;
+         }
+
+         static constexpr bool BatchPreferred = IsBatchPreferred< typename DecayT::Iterator >::value;
+
+         template< class B >
+         size_t NextBatch( B& b ) const
+         {
+            if( mRemaining < B::Capacity )
+            {
+               return FillBatch( *this, b );
+            }
+            auto size = d::NextBatch( this->mIterator, b );
+            mRemaining -= size;
+            return size;
+         }
+      };
+
+      size_t mDegree;
+      bool mOrdered;
+
+      Partitioning GetPartitioning() const
+      {
+         return { this->mShim.Size(), mDegree, mOrdered };
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this->mShim.Size() };
+      };
+
+      Iterator CreateIterator( size_t begin, size_t end ) const
+      {
+         auto ret = this->mShim.CreateIterator();
+         d::Advance( ret, begin );
+         return { { std::move( ret ) }, end - begin };
+      };
+
+      size_t Size() const
+      {
+         return this->mShim.Size();
+      }
+
+      decltype( auto ) At( size_t i ) const
+      {
+         return this->mShim.At( i );
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsContiguous< U >::value, int > = 0 >
+      auto Data() const
+      {
+         return this->mShim.Data();
+      }
+   };
+
+   // Unordered: ToVector() returns the elements in whatever order the chunks complete. A degree of zero uses every thread of the pool.
+   template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+   Shim< ParallelShim > AsParallel( size_t degree = 0 ) const&
+   {
+      return { { { { { this->mShim } }, degree, false } } };
+   }
+
+   template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+   Shim< ParallelShim > AsParallel( size_t degree = 0 ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, degree, false } } };
+   }
+
+   template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+   Shim< ParallelShim > AsOrderedParallel( size_t degree = 0 ) const&
+   {
+      return { { { { { this->mShim } }, degree, true } } };
+   }
+
+   template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+   Shim< ParallelShim > AsOrderedParallel( size_t degree = 0 ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, degree, true } } };
+   }
+
+   // AsSequential
+   struct SequentialShim : ShimBase< T >
+   {
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      using Iterator = typename DecayT::Iterator;
+
+      Iterator CreateIterator() const
+      {
+         return this->mShim.CreateIterator();
+      };
+   };
+
+   Shim< SequentialShim > AsSequential() const&
+   {
+      return { { { { this->mShim } } } };
+   }
+
+   Shim< SequentialShim > AsSequential() &&
+   {
+      return { { { { std::forward< T >( this->mShim ) } } } };
+   }
+
+   // AsSorted
+   struct SortedShim : ShimBase< T >
+   {
+      static constexpr bool Sorted = true;
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      using Iterator = typename DecayT::Iterator;
+
+      Iterator CreateIterator() const
+      {
+         return this->mShim.CreateIterator();
+      };
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      size_t Size() const
+      {
+         return this->mShim.Size();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      decltype( auto ) At( size_t i ) const
+      {
+         return this->mShim.At( i );
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsContiguous< U >::value, int > = 0 >
+      auto Data() const
+      {
+         return this->mShim.Data();
+      }
+   };
+
+   // Declares that the elements ascend by operator<, which lets IsIntersect(), Overlaps() and IntersectCount() merge.
+   Shim< SortedShim > AsSorted() const&
+   {
+      return { { { { this->mShim } } } };
+   }
+
+   Shim< SortedShim > AsSorted() &&
+   {
+      return { { { { std::forward< T >( this->mShim ) } } } };
+   }
+
+   struct WithAllocatorShim : ShimBase< T >
+   {
+      static constexpr bool Resourced = true;
+      static constexpr bool Sorted = IsSorted< DecayT >::value;
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      using Iterator = typename DecayT::Iterator;
+
+      std::pmr::memory_resource* mResource;
+
+      std::pmr::memory_resource* GetResource() const
+      {
+         return mResource;
+      }
+
+      Iterator CreateIterator() const
+      {
+         return this->mShim.CreateIterator();
+      };
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      size_t Size() const
+      {
+         return this->mShim.Size();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      decltype( auto ) At( size_t i ) const
+      {
+         return this->mShim.At( i );
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsContiguous< U >::value, int > = 0 >
+      auto Data() const
+      {
+         return this->mShim.Data();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Partitioning GetPartitioning() const
+      {
+         return this->mShim.GetPartitioning();
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsPartitioned< U >::value, int > = 0 >
+      Iterator CreateIterator( size_t begin, size_t end ) const
+      {
+         return this->mShim.CreateIterator( begin, end );
+      };
+   };
+
+   // Every container that the stages downstream and the To...() operators build is allocated from resource, so that
+   // a request-scoped arena can take all of them. A pipeline that runs on the pool may allocate from several threads
+   // at once, so it needs a thread-safe resource such as std::pmr::synchronized_pool_resource.
+   Shim< WithAllocatorShim > WithAllocator( std::pmr::memory_resource* resource ) const&
+   {
+      return { { { { { this->mShim } }, resource } } };
+   }
+
+   Shim< WithAllocatorShim > WithAllocator( std::pmr::memory_resource* resource ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, resource } } };
+   }
+
+   // OrderBy
+   // The keys of every element are extracted once, next to its index. The iterator sorts only as far as it is read:
+   // blocks of growing size are selected with nth_element and sorted, so First() or Take( k ) cost about O( n + k log k ).
+   // Equal keys keep the order of the source.
+   template< class... K >
+   struct OrderByShim : ShimBase< T >
+   {
+      using Keys = std::tuple< std::decay_t< std::invoke_result_t< typename K::Functor&, const DecayValueType& > >... >;
+
+      struct Entry
+      {
+         Keys mKeys;
+         size_t mIndex;
+      };
+
+      template< size_t I = 0 >
+      static bool Compare( const Entry& a, const Entry& b )
+      {
+         if constexpr( I == sizeof...( K ) )
+         {
+            return a.mIndex < b.mIndex;
+         }
+         else
+         {
+            constexpr auto descending = std::tuple_element_t< I, std::tuple< K... > >::Descending;
+            auto& x = std::get< I >( a.mKeys );
+            auto& y = std::get< I >( b.mKeys );
+            if( descending ? y < x : x < y )
+            {
+               return true;
+            }
+            if( descending ? x < y : y < x )
+            {
+               return false;
+            }
+            return Compare< I + 1 >( a, b );
+         }
+      }
+
+      struct Less
+      {
+         bool operator()( const Entry& a, const Entry& b ) const
+         {
+            return Compare( a, b );
+         }
+      };
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = optional< DecayValueType >;
+
+         static constexpr size_t MinBlock = 64;
+
+         const OrderByShim* mOwner;
+         mutable bool mStarted = false;
+         mutable std::vector< DecayValueType > mValues;
+         mutable std::vector< Entry > mEntries;
+         mutable size_t mPosition = 0;
+         mutable size_t mSorted = 0;
+         mutable size_t mBlock = MinBlock;
+
+         void Start() const
+         {
+            if( mStarted )
+            {
+               return;
+            }
+            mStarted = true;
+            mValues.reserve( mOwner->mShim.GetSizeHint().Capacity( sizeof( DecayValueType ) ) );
+            AppendTo( this->mIterator, mValues );
+            mEntries.reserve( mValues.size() );
+            auto& keys = const_cast< std::tuple< K... >& >( mOwner->mKeys );
+            for( size_t i = 0; i < mValues.size(); ++i )
+            {
+               auto& value = std::as_const( mValues[ i ] );
+               mEntries.push_back( { std::apply( [ & ]( auto&... k ) { return Keys{ k.mFunctor( value )... }; }, keys ), i } );
+            }
+         }
+
+         // Sorts the next block unless the current position is already in place; false at the end.
+         bool Ready() const
+         {
+            Start();
+            if( mPosition < mSorted )
+            {
+               return true;
+            }
+            auto size = mEntries.size();
+            if( mPosition >= size )
+            {
+               return false;
+            }
+            auto begin = mEntries.begin() + mPosition;
+            if( mBlock >= ( size - mPosition ) / 8 )
+            {
+               std::sort( begin, mEntries.end(), Less{} );
+               mSorted = size;
+            }
+            else
+            {
+               std::nth_element( begin, begin + mBlock, mEntries.end(), Less{} );
+               std::sort( begin, begin + mBlock, Less{} );
+               mSorted = mPosition + mBlock;
+               mBlock *= 8;
+            }
+            return true;
+         }
+
+         ResultType Next() const
+         {
+            if( !Ready() )
+            {
+               return {};
+            }
+            return std::move( mValues[ mEntries[ mPosition++ ].mIndex ] );
+         }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            while( Ready() )
+            {
+               for( ; mPosition < mSorted; )
+               {
+                  if( !s( std::move( mValues[ mEntries[ mPosition++ ].mIndex ] ) ) )
+                  {
+                     return false;
+                  }
+               }
+            }
+            return true;
+         }
+
+         // The skipped elements only have to precede the rest, not to be sorted among themselves.
+         void Advance( size_t n ) const
+         {
+            Start();
+            auto size = mEntries.size();
+            n = std::min( n, size - mPosition );
+            if( mPosition + n > mSorted && mPosition + n < size )
+            {
+               std::nth_element( mEntries.begin() + mSorted, mEntries.begin() + mPosition + n, mEntries.end(), Less{} );
+               mSorted = mPosition + n;
+            }
+            mPosition += n;
+            mSorted = std::max( mSorted, mPosition );
+         }
+      };
+
+      std::tuple< K... > mKeys;
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this };
+      };
+
+      template< bool Descending, class F >
+      OrderByShim< K..., SortKey< F, Descending > > ThenBy( F&& f ) const&
+      {
+         return { { this->mShim }, std::tuple_cat( mKeys, std::tuple< SortKey< F, Descending > >{ { std::forward< F >( f ) } } ) };
+      }
+
+      template< bool Descending, class F >
+      OrderByShim< K..., SortKey< F, Descending > > ThenBy( F&& f ) &&
+      {
+         return { { std::forward< T >( this->mShim ) }, std::tuple_cat( std::move( mKeys ), std::tuple< SortKey< F, Descending > >{ { std::forward< F >( f ) } } ) };
+      }
+   };
+
+   template< class F >
+   Shim< OrderByShim< SortKey< F, false > > > OrderBy( F&& f ) const&
+   {
+      return { { { { { this->mShim } }, { { std::forward< F >( f ) } } } } };
+   }
+
+   template< class F >
+   Shim< OrderByShim< SortKey< F, false > > > OrderBy( F&& f ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, { { std::forward< F >( f ) } } } } };
+   }
+
+   template< class F >
+   Shim< OrderByShim< SortKey< F, true > > > OrderByDescending( F&& f ) const&
+   {
+      return { { { { { this->mShim } }, { { std::forward< F >( f ) } } } } };
+   }
+
+   template< class F >
+   Shim< OrderByShim< SortKey< F, true > > > OrderByDescending( F&& f ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, { { std::forward< F >( f ) } } } } };
+   }
+
+   // ThenBy and ThenByDescending refine the order of an OrderBy stage.
+   template< class F, class U = DecayT >
+   Shim< decltype( std::declval< const U& >().template ThenBy< false >( std::declval< F >() ) ) > ThenBy( F&& f ) const&
+   {
+      return { { this->mShim.template ThenBy< false >( std::forward< F >( f ) ) } };
+   }
+
+   template< class F, class U = DecayT >
+   Shim< decltype( std::declval< U >().template ThenBy< false >( std::declval< F >() ) ) > ThenBy( F&& f ) &&
+   {
+      return { { std::forward< T >( this->mShim ).template ThenBy< false >( std::forward< F >( f ) ) } };
+   }
+
+   template< class F, class U = DecayT >
+   Shim< decltype( std::declval< const U& >().template ThenBy< true >( std::declval< F >() ) ) > ThenByDescending( F&& f ) const&
+   {
+      return { { this->mShim.template ThenBy< true >( std::forward< F >( f ) ) } };
+   }
+
+   template< class F, class U = DecayT >
+   Shim< decltype( std::declval< U >().template ThenBy< true >( std::declval< F >() ) ) > ThenByDescending( F&& f ) &&
+   {
+      return { { std::forward< T >( this->mShim ).template ThenBy< true >( std::forward< F >( f ) ) } };
+   }
+
+   // GroupBy
+   // The first read drains the source into a flat hash table, folding every element into the accumulator of its key;
+   // then the ( key, accumulator ) pairs come out in the order of the table.
+   template< class KS, class A, class F >
+   struct GroupByShim : ShimBase< T >
+   {
+      using Key = std::decay_t< std::invoke_result_t< KS&, const DecayValueType& > >;
+      using Table = FlatHashMap< Key, A >;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = optional< std::pair< Key, A > >;
+
+         const GroupByShim* mOwner;
+         mutable optional< Table > mTable;
+         mutable size_t mPosition = 0;
+
+         Table& Groups() const
+         {
+            if( !mTable.is_initialized() )
+            {
+               mTable.emplace();
+               auto& table = mTable.value();
+               table.Reserve( mOwner->GetSizeHint().Capacity( sizeof( typename Table::Entry ) ) );
+               auto& keySelector = const_cast< KS& >( mOwner->mKeySelector );
+               auto& fold = const_cast< F& >( mOwner->mFold );
+               d::ForEach( this->mIterator, [ & ]( auto&& v ) {
+                  auto& a = *table.TryEmplace( keySelector( std::as_const( v ) ), mOwner->mSeed ).first;
+                  if constexpr( std::is_void< std::invoke_result_t< F&, A&, decltype( v ) > >::value )
+                  {
+                     fold( a, std::forward< decltype( v ) >( v ) );
+                  }
+                  else
+                  {
+                     a = fold( std::move( a ), std::forward< decltype( v ) >( v ) );
+                  }
+                  return true;
+               } );
+            }
+            return mTable.value();
+         }
+
+         ResultType Next() const
+         {
+            auto& slots = Groups().Slots();
+            for( ; mPosition != slots.size(); ++mPosition )
+            {
+               if( slots[ mPosition ].is_initialized() )
+               {
+                  return std::move( slots[ mPosition++ ] ).value();
+               }
+            }
+            return {};
+         }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto& slots = Groups().Slots();
+            for( ; mPosition != slots.size(); ++mPosition )
+            {
+               if( slots[ mPosition ].is_initialized() && !s( std::move( slots[ mPosition ] ).value() ) )
+               {
+                  ++mPosition;
+                  return false;
+               }
+            }
+            return true;
+         }
+      };
+
+      KS mKeySelector;
+      A mSeed;
+      F mFold;
+
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Filter();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this };
+      };
+   };
+
+   // Groups of the elements by key, as ( key, std::vector of the elements ) pairs.
+   template< class KS >
+   Shim< GroupByShim< KS, std::vector< DecayValueType >, Append > > GroupBy( KS&& keySelector ) const&
+   {
+      return { { { { { this->mShim } }, std::forward< KS >( keySelector ), {}, {} } } };
+   }
+
+   template< class KS >
+   Shim< GroupByShim< KS, std::vector< DecayValueType >, Append > > GroupBy( KS&& keySelector ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< KS >( keySelector ), {}, {} } } };
+   }
+
+   // ( key, accumulator ) pairs. Each accumulator starts as a copy of seed; fold( a, element ) either updates a in place
+   // or returns its next value.
+   template< class KS, class A, class F >
+   Shim< GroupByShim< KS, A, F > > GroupByAggregate( KS&& keySelector, A seed, F&& fold ) const&
+   {
+      return { { { { { this->mShim } }, std::forward< KS >( keySelector ), std::move( seed ), std::forward< F >( fold ) } } };
+   }
+
+   template< class KS, class A, class F >
+   Shim< GroupByShim< KS, A, F > > GroupByAggregate( KS&& keySelector, A seed, F&& fold ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, std::forward< KS >( keySelector ), std::move( seed ), std::forward< F >( fold ) } } };
+   }
+
+   // Take
+   struct TakeShim : ShimBase< T >
+   {
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = typename base::ResultType;
+
+         mutable size_t mCount;
+
+         ResultType Next() const
+         {
+            if( mCount == 0 )
+            {
+               return {};
+            }
+            --mCount;
+            return this->mIterator.Next();
+         }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            if( mCount == 0 )
+            {
+               return true;
+            }
+            auto stopped = false;
+            d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               --mCount;
+               if( !s( std::forward< decltype( v ) >( v ) ) )
+               {
+                  stopped = true;
+                  return false;
+               }
+               return mCount != 0;
+            } );
+            return !stopped;
+         }
+
+         void Advance( size_t n ) const
+         {
+            n = std::min( n, mCount );
+            d::Advance( this->mIterator, n );
+            mCount -= n;
+         }
+      };
+
+      size_t mCount;
+
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Take( mCount );
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, mCount };
+      };
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      size_t Size() const
+      {
+         return std::min( mCount, this->mShim.Size() );
+      }
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      decltype( auto ) At( size_t i ) const
+      {
+         return this->mShim.At( i );
+      }
+   };
+
+   Shim< TakeShim > Take( size_t count ) const&
+   {
+      return { { { { { this->mShim } }, count } } };
+   }
+
+   Shim< TakeShim > Take( size_t count ) &&
+   {
+      return { { { { { std::forward< T >( this->mShim ) } }, count } } };
+   }
+
+   // Skip
+   struct SkipShim : ShimBase< T >
+   {
+      static constexpr bool Stable = IsStable< DecayT >::value;
+
+      using Iterator = typename DecayT::Iterator;
+
+      size_t mCount;
+
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Skip( mCount );
+      }
+
+      Iterator CreateIterator() const
+      {
+         auto ret = this->mShim.CreateIterator();
+         d::Advance( ret, mCount );
+         return ret;
+      };
+
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      size_t Size() const
+      {
+         auto size = this->mShim.Size();
+         return size > mCount ? size - mCount : 0;
+      }
 
-   template< class F >
-   auto Take( size_t count ) &&
-   {
-      return std::move( *this ).Until( [ count ]( const auto& ) mutable { return count-- == 0; } );
-   }
+      template< class U = DecayT, std::enable_if_t< IsRandomAccess< U >::value, int > = 0 >
+      decltype( auto ) At( size_t i ) const
+      {
+         return this->mShim.At( mCount + i );
+      }
+   };
 
-   // Skip
-   auto Skip( size_t count ) const&
+   Shim< SkipShim > Skip( size_t count ) const&
    {
-      return this->Where( [ count ]( const auto& ) mutable { return count == 0 || count-- == 0; } );
+      return { { { { { this->mShim } }, count } } };
    }
 
-   template< class F >
-   auto Skip( size_t count ) &&
+   Shim< SkipShim > Skip( size_t count ) &&
    {
-      return std::move( *this ).Where( [ count ]( const auto& ) mutable { return count == 0 || count-- == 0; } );
+      return { { { { { std::forward< T >( this->mShim ) } }, count } } };
    }
 
    // Throttle
@@ -794,6 +3233,11 @@ struct Shim : ShimBase< T >
       size_t mCount;
       typename DecayT::Iterator mIterator;
 
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Take( mCount ).Filter();
+      }
+
       Iterator CreateIterator() const
       {
          return { { mIterator }, mCount, this };
@@ -829,9 +3273,9 @@ struct Shim : ShimBase< T >
 
       size_t mCount;
 
-      size_t GetCapacity() const
+      SizeHint GetSizeHint() const
       {
-         return this->mShim.GetCapacity();
+         return this->mShim.GetSizeHint().Throttle( mCount );
       }
 
       Iterator CreateIterator() const
@@ -851,28 +3295,260 @@ struct Shim : ShimBase< T >
    }
 
    // Distinct
+   // Every iterator keeps its own record of the keys seen. An AsSorted() source only compares each key with the previous
+   // one. Otherwise the first SmallMax keys are searched linearly in place, and past them a flat hash table reserved from
+   // the size hint takes over. When the keys are references into a source that outlives the iteration, the record holds
+   // pointers and hashes instead of copies.
+   template< class F >
+   struct DistinctShim : ShimBase< T >
+   {
+      using KeyResult = std::invoke_result_t< F&, const std::remove_reference_t< ValueType >& >;
+      using Key = std::decay_t< KeyResult >;
+
+      static constexpr bool Stable = IsStable< DecayT >::value;
+      static constexpr bool ByReference = Stable && std::is_lvalue_reference< ValueType >::value && std::is_lvalue_reference< KeyResult >::value &&
+                                          !std::is_trivially_copyable< Key >::value;
+      static constexpr size_t SmallMax = 8;
+
+      struct Ref
+      {
+         const Key* mKey;
+         size_t mHash;
+      };
+
+      struct RefHash
+      {
+         size_t operator()( const Ref& r ) const
+         {
+            return r.mHash;
+         }
+      };
+
+      struct RefEqual
+      {
+         bool operator()( const Ref& a, const Ref& b ) const
+         {
+            return a.mHash == b.mHash && *a.mKey == *b.mKey;
+         }
+      };
+
+      using Stored = std::conditional_t< ByReference, const Key*, Key >;
+      using Table = std::conditional_t< ByReference, FlatHashMap< Ref, bool, RefHash, RefEqual, Allocator< std::pair< Ref, bool > > >,
+                                        FlatHashMap< Key, bool, Hash< Key >, std::equal_to<>, Allocator< std::pair< Key, bool > > > >;
+
+      // Plain keys sit in the small set as they are, others in optionals.
+      static constexpr bool Plain = !ByReference && std::is_trivially_copyable< Key >::value && std::is_default_constructible< Key >::value;
+      using Slot = std::conditional_t< Plain, Stored, optional< Stored > >;
+
+      struct Iterator : ShimIt< typename DecayT::Iterator >
+      {
+         using base = ShimIt< typename DecayT::Iterator >;
+         using ResultType = typename base::ResultType;
+
+         const DistinctShim* mOwner;
+         mutable std::array< Slot, SmallMax > mSmall{};
+         mutable size_t mSmallSize = 0;
+         mutable optional< Table > mTable;
+
+         static Stored& Value( Slot& slot )
+         {
+            if constexpr( Plain )
+            {
+               return slot;
+            }
+            else
+            {
+               return *slot;
+            }
+         }
+
+         static const Key& Get( const Slot& slot )
+         {
+            auto& stored = Value( const_cast< Slot& >( slot ) );
+            if constexpr( ByReference )
+            {
+               return *stored;
+            }
+            else
+            {
+               return stored;
+            }
+         }
+
+         template< class K >
+         static void Store( Slot& slot, K&& key )
+         {
+            if constexpr( ByReference )
+            {
+               slot = std::addressof( key );
+            }
+            else if constexpr( Plain )
+            {
+               slot = std::forward< K >( key );
+            }
+            else
+            {
+               slot.emplace( std::forward< K >( key ) );
+            }
+         }
+
+         template< class K >
+         bool Emplace( K&& key ) const
+         {
+            if constexpr( ByReference )
+            {
+               return mTable.value().TryEmplace( Ref{ std::addressof( key ), Hash< Key >()( key ) } ).second;
+            }
+            else
+            {
+               return mTable.value().TryEmplace( std::forward< K >( key ) ).second;
+            }
+         }
+
+         bool Small( const Key& key ) const
+         {
+            for( size_t i = 0, size = mSmallSize; i < size; ++i )
+            {
+               if( Get( mSmall[ i ] ) == key )
+               {
+                  return true;
+               }
+            }
+            return false;
+         }
+
+         // Whether the key is seen for the first time.
+         template< class K >
+         bool Insert( K&& key ) const
+         {
+            if constexpr( IsSorted< DecayT >::value )
+            {
+               if( mSmallSize != 0 && Get( mSmall[ 0 ] ) == key )
+               {
+                  return false;
+               }
+               Store( mSmall[ 0 ], std::forward< K >( key ) );
+               mSmallSize = 1;
+               return true;
+            }
+            else
+            {
+               if( !mTable.is_initialized() )
+               {
+                  if( Small( key ) )
+                  {
+                     return false;
+                  }
+                  if( mSmallSize < SmallMax )
+                  {
+                     Store( mSmall[ mSmallSize++ ], std::forward< K >( key ) );
+                     return true;
+                  }
+                  Grow();
+               }
+               return Emplace( std::forward< K >( key ) );
+            }
+         }
+
+         // Moves the small set into the table; kept out of line so that the small set path stays short.
+         void Grow() const
+         {
+            mTable.emplace( mOwner->template GetAllocator< typename Table::Entry >() );
+            mTable.value().Reserve( mOwner->mShim.GetSizeHint().Filter().Capacity( sizeof( typename Table::Slot ) ) );
+            for( auto& m : mSmall )
+            {
+               if constexpr( ByReference )
+               {
+                  Emplace( *Value( m ) );
+               }
+               else
+               {
+                  Emplace( std::move( Value( m ) ) );
+               }
+            }
+            mSmall = {};
+         }
+
+         ResultType Next() const
+         {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            for( ;; )
+            {
+               auto result = this->mIterator.Next();
+               if( !result.is_initialized() )
+               {
+                  return {};
+               }
+               if( Insert( f( std::as_const( result.value() ) ) ) )
+               {
+                  return result;
+               }
+            }
+         }
+
+         template< class S >
+         bool ForEach( S&& s ) const
+         {
+            auto& f = const_cast< F& >( mOwner->mFunctor );
+            return d::ForEach( this->mIterator, [ & ]( auto&& v ) -> bool {
+               if( Insert( f( std::as_const( v ) ) ) )
+               {
+                  return s( std::forward< decltype( v ) >( v ) );
+               }
+               return true;
+            } );
+         }
+      };
+
+      F mFunctor;
+
+      SizeHint GetSizeHint() const
+      {
+         return this->mShim.GetSizeHint().Filter();
+      }
+
+      Iterator CreateIterator() const
+      {
+         return { { this->mShim.CreateIterator() }, this };
+      };
+   };
+
+   // The elements whose f( element ) differs from that of every element before them. The record of the keys isn't
+   // thread safe, so a parallel pipeline goes on sequentially.
    template< class F >
    auto Distinct( F&& f ) const&
    {
-      std::unordered_set< std::invoke_result_t< F, DecayValueType > > set;
-      return this->Where( [ set{ std::move( set ) }, f{ std::forward< F >( f ) } ]( const DecayValueType& m ) mutable { return set.insert( f( m ) ).second; } );
+      if constexpr( IsPartitioned< DecayT >::value )
+      {
+         return AsSequential().Distinct( std::forward< F >( f ) );
+      }
+      else
+      {
+         return Shim< DistinctShim< F > >{ { { { { this->mShim } }, std::forward< F >( f ) } } };
+      }
    }
 
    template< class F >
    auto Distinct( F&& f ) &&
    {
-      std::unordered_set< std::invoke_result_t< F, DecayValueType > > set;
-      return std::move( *this ).Where( [ set{ std::move( set ) }, f{ std::forward< F >( f ) } ]( const DecayValueType& m ) mutable { return set.insert( f( m ) ).second; } );
+      if constexpr( IsPartitioned< DecayT >::value )
+      {
+         return std::move( *this ).AsSequential().Distinct( std::forward< F >( f ) );
+      }
+      else
+      {
+         return Shim< DistinctShim< F > >{ { { { { std::forward< T >( this->mShim ) } }, std::forward< F >( f ) } } };
+      }
    }
 
    auto Distinct() const&
    {
-      return this->Distinct( []( DecayValueType m ) { return m; } );
+      return this->Distinct( sort::Identity{} );
    }
 
    auto Distinct() &&
    {
-      return std::move( *this ).Distinct( []( DecayValueType m ) { return m; } );
+      return std::move( *this ).Distinct( sort::Identity{} );
    }
 
    // Move
@@ -910,63 +3586,160 @@ struct Shim : ShimBase< T >
    auto ToEnumerable() const&;
    auto ToEnumerable() &&;
 
+   // #include <linqcpp/async.h> is required
+   auto AsAsync() const&;
+   auto AsAsync() &&;
+   template< class S >
+   auto AsAsync( S&& scheduler ) const&;
+   template< class S >
+   auto AsAsync( S&& scheduler ) &&;
+
    template< class I >
    void StdEmplace( I i ) const
    {
-      for( auto it = this->mShim.CreateIterator();; )
+      d::ForEach( this->mShim.CreateIterator(), [ & ]( auto&& v ) {
+         i++ = std::forward< decltype( v ) >( v );
+         return true;
+      } );
+   }
+
+   template< class A, std::enable_if_t< IsAllocator< A >::value, int > = 0 >
+   std::list< DecayValueType, RebindAllocator< A, DecayValueType > > ToList( const A& a ) const
+   {
+      std::list< DecayValueType, RebindAllocator< A, DecayValueType > > ret( a );
+      StdEmplace( std::back_inserter( ret ) );
+      return ret;
+   }
+
+   std::list< DecayValueType, Allocator< DecayValueType > > ToList() const
+   {
+      return ToList( this->template GetAllocator< DecayValueType >() );
+   }
+
+   template< class A, std::enable_if_t< IsAllocator< A >::value, int > = 0 >
+   std::deque< DecayValueType, RebindAllocator< A, DecayValueType > > ToDeque( const A& a ) const
+   {
+      std::deque< DecayValueType, RebindAllocator< A, DecayValueType > > ret( a );
+      StdEmplace( std::back_inserter( ret ) );
+      return ret;
+   }
+
+   std::deque< DecayValueType, Allocator< DecayValueType > > ToDeque() const
+   {
+      return ToDeque( this->template GetAllocator< DecayValueType >() );
+   }
+
+   template< class I, class C >
+   static void AppendTo( const I& iterator, C& ret )
+   {
+      if constexpr( IsBatchPreferred< I >::value )
       {
-         auto result = it.Next();
-         if( result.is_initialized() )
+         Batch< ValueType > batch;
+         while( d::NextBatch( iterator, batch ) )
+         {
+            batch.AppendTo( ret );
+         }
+      }
+      else
+      {
+         d::ForEach( iterator, [ & ]( auto&& v ) {
+            ret.push_back( std::forward< decltype( v ) >( v ) );
+            return true;
+         } );
+      }
+   }
+
+   // The partial results of a parallel pipeline use the default allocator, so that only the calling thread allocates from a.
+   template< class A, std::enable_if_t< IsAllocator< A >::value, int > = 0 >
+   std::vector< DecayValueType, RebindAllocator< A, DecayValueType > > ToVector( size_t capacity, const A& a ) const
+   {
+      std::vector< DecayValueType, RebindAllocator< A, DecayValueType > > ret( a );
+      ret.reserve( capacity );
+      if constexpr( IsPartitioned< DecayT >::value )
+      {
+         auto partitioning = this->mShim.GetPartitioning();
+         if( partitioning.mOrdered )
          {
-            i++ = std::move( result ).value();
+            std::vector< std::vector< DecayValueType > > partials( partitioning.Chunks() );
+            ParallelFor( this->mShim, [ & ]( const auto& iterator, size_t chunk ) { AppendTo( iterator, partials[ chunk ] ); } );
+            for( auto& partial : partials )
+            {
+               std::move( std::begin( partial ), std::end( partial ), std::back_inserter( ret ) );
+            }
          }
          else
          {
-            break;
+            std::mutex mutex;
+            ParallelFor( this->mShim, [ & ]( const auto& iterator, size_t ) {
+               std::vector< DecayValueType > partial;
+               AppendTo( iterator, partial );
+               std::lock_guard< std::mutex > lock( mutex );
+               std::move( std::begin( partial ), std::end( partial ), std::back_inserter( ret ) );
+            } );
          }
+         return ret;
       }
+      AppendTo( this->mShim.CreateIterator(), ret );
+      return ret;
    }
 
-   std::list< DecayValueType > ToList() const
+   template< class A, std::enable_if_t< IsAllocator< A >::value, int > = 0 >
+   std::vector< DecayValueType, RebindAllocator< A, DecayValueType > > ToVector( const A& a ) const
    {
-      std::list< DecayValueType > ret;
-      StdEmplace( std::back_inserter( ret ) );
-      return ret;
+      return ToVector( GetCapacity(), a );
    }
 
-   std::deque< DecayValueType > ToDeque() const
+   std::vector< DecayValueType, Allocator< DecayValueType > > ToVector( size_t capacity ) const
    {
-      std::deque< DecayValueType > ret;
-      StdEmplace( std::back_inserter( ret ) );
-      return ret;
+      return ToVector( capacity, this->template GetAllocator< DecayValueType >() );
    }
 
-   std::vector< DecayValueType > ToVector( size_t capacity ) const
+   std::vector< DecayValueType, Allocator< DecayValueType > > ToVector() const
    {
-      std::vector< DecayValueType > ret;
-      ret.reserve( capacity );
-      StdEmplace( std::back_inserter( ret ) );
-      return ret;
+      return ToVector( GetCapacity() );
    }
 
-   std::vector< DecayValueType > ToVector() const
+   // f is either a comparator or a key projection. Large results are sorted on the pool, with the degree of AsParallel() if any.
+   template< typename F >
+   std::vector< DecayValueType > Sorted( bool stable, F&& f ) const
    {
-      return ToVector( this->mShim.GetCapacity() );
+      size_t degree = 0;
+      if constexpr( IsPartitioned< DecayT >::value )
+      {
+         degree = this->mShim.GetPartitioning().mDegree;
+      }
+      auto ret = ToVector( std::allocator< DecayValueType >() );
+      if constexpr( std::is_invocable< F&, const DecayValueType& >::value )
+      {
+         sort::Sort( ret, stable, degree, f );
+      }
+      else
+      {
+         sort::CompareSort( ret, stable, degree, f );
+      }
+      return ret;
    }
 
    std::vector< DecayValueType > ToOrderedVector() const
    {
-      auto ret = ToVector();
-      std::sort( std::begin( ret ), std::end( ret ) );
-      return ret;
+      return Sorted( false, sort::Identity{} );
    }
 
    template< typename F >
    std::vector< DecayValueType > ToOrderedVector( F&& f ) const
    {
-      auto ret = ToVector();
-      std::sort( std::begin( ret ), std::end( ret ), std::forward< F >( f ) );
-      return ret;
+      return Sorted( false, std::forward< F >( f ) );
+   }
+
+   std::vector< DecayValueType > ToStableOrderedVector() const
+   {
+      return Sorted( true, sort::Identity{} );
+   }
+
+   template< typename F >
+   std::vector< DecayValueType > ToStableOrderedVector( F&& f ) const
+   {
+      return Sorted( true, std::forward< F >( f ) );
    }
 
    template< size_t N, typename P = DecayValueType >
@@ -1011,25 +3784,56 @@ struct Shim : ShimBase< T >
       throw std::out_of_range( "The number of elements is not equal." );
    }
 
-   std::unordered_set< DecayValueType > ToUnorderedSet() const
+   template< class A, std::enable_if_t< IsAllocator< A >::value, int > = 0 >
+   std::unordered_set< DecayValueType, std::hash< DecayValueType >, std::equal_to< DecayValueType >, RebindAllocator< A, DecayValueType > >
+   ToUnorderedSet( const A& a ) const
    {
-      std::unordered_set< DecayValueType > ret;
-      ret.reserve( this->mShim.GetCapacity() );
+      std::unordered_set< DecayValueType, std::hash< DecayValueType >, std::equal_to< DecayValueType >, RebindAllocator< A, DecayValueType > > ret( a );
+      ret.reserve( GetCapacity() );
+      if constexpr( IsPartitioned< DecayT >::value )
+      {
+         std::mutex mutex;
+         ParallelFor( this->mShim, [ & ]( const auto& iterator, size_t ) {
+            std::unordered_set< DecayValueType > partial;
+            d::ForEach( iterator, [ & ]( auto&& v ) {
+               partial.insert( std::forward< decltype( v ) >( v ) );
+               return true;
+            } );
+            std::lock_guard< std::mutex > lock( mutex );
+            if constexpr( std::is_same< decltype( partial ), decltype( ret ) >::value )
+            {
+               ret.merge( partial );
+            }
+            else
+            {
+               while( !partial.empty() )
+               {
+                  ret.insert( std::move( partial.extract( partial.begin() ).value() ) );
+               }
+            }
+         } );
+         return ret;
+      }
       StdEmplace( std::inserter( ret, ret.end() ) );
       return ret;
    }
 
+   std::unordered_set< DecayValueType, std::hash< DecayValueType >, std::equal_to< DecayValueType >, Allocator< DecayValueType > > ToUnorderedSet() const
+   {
+      return ToUnorderedSet( this->template GetAllocator< DecayValueType >() );
+   }
+
    template< typename ValueType2, typename F >
-   std::unordered_set< ValueType2 > ToUnorderedSet( F&& f ) const
+   std::unordered_set< ValueType2, std::hash< ValueType2 >, std::equal_to< ValueType2 >, Allocator< ValueType2 > > ToUnorderedSet( F&& f ) const
    {
       return this->Ref().template Select< ValueType2 >( std::forward< F >( f ) ).ToUnorderedSet();
    }
 
-   template< typename K, typename V, typename KS, typename VS >
-   auto ToUnorderedMap( KS&& keySelector, VS&& valueSelector ) const
+   template< typename K, typename V, typename KS, typename VS, class A, std::enable_if_t< IsAllocator< A >::value, int > = 0 >
+   auto ToUnorderedMap( KS&& keySelector, VS&& valueSelector, const A& a ) const
    {
-      std::unordered_map< K, V > ret;
-      ret.reserve( this->mShim.GetCapacity() );
+      std::unordered_map< K, V, std::hash< K >, std::equal_to< K >, RebindAllocator< A, std::pair< const K, V > > > ret( a );
+      ret.reserve( GetCapacity() );
       for( auto it = this->mShim.CreateIterator();; )
       {
          auto result = it.Next();
@@ -1046,50 +3850,110 @@ struct Shim : ShimBase< T >
       return ret;
    }
 
+   template< typename K, typename V, typename KS, typename VS >
+   auto ToUnorderedMap( KS&& keySelector, VS&& valueSelector ) const
+   {
+      return ToUnorderedMap< K, V >( std::forward< KS >( keySelector ), std::forward< VS >( valueSelector ),
+                                     this->template GetAllocator< std::pair< const K, V > >() );
+   }
+
    template< typename K, typename KS >
    auto ToUnorderedMap( KS&& keySelector ) const
    {
       return ToUnorderedMap< K, DecayValueType >( std::forward< KS >( keySelector ), []( const auto v1, auto& v2 ) { v2 = v1; } );
    }
 
+   HashIndex< DecayValueType, DecayValueType > ToHashIndex() const
+   {
+      return { ToVector( std::allocator< DecayValueType >() ), sort::Identity{} };
+   }
+
+   template< class KS >
+   HashIndex< std::decay_t< std::invoke_result_t< KS&, const DecayValueType& > >, DecayValueType > ToHashIndex( KS&& keySelector ) const
+   {
+      return { ToVector( std::allocator< DecayValueType >() ), keySelector };
+   }
+
+   SortedIndex< DecayValueType, DecayValueType > ToSortedIndex() const
+   {
+      return { ToVector( std::allocator< DecayValueType >() ), sort::Identity{} };
+   }
+
+   template< class KS >
+   SortedIndex< std::decay_t< std::invoke_result_t< KS&, const DecayValueType& > >, DecayValueType > ToSortedIndex( KS&& keySelector ) const
+   {
+      return { ToVector( std::allocator< DecayValueType >() ), keySelector };
+   }
+
    size_t Count() const
    {
-      size_t ret = 0;
-      for( auto it = this->mShim.CreateIterator();; )
+      if constexpr( IsRandomAccess< DecayT >::value )
       {
-         auto result = it.Next();
-         if( result.is_initialized() )
-         {
-            ++ret;
-         }
-         else
+         return this->mShim.Size();
+      }
+      else if constexpr( IsPartitioned< DecayT >::value )
+      {
+         std::atomic< size_t > ret{ 0 };
+         ParallelFor( this->mShim, [ & ]( const auto& iterator, size_t ) { ret += d::Count( iterator ); } );
+         return ret;
+      }
+      else
+      {
+         return d::Count( this->mShim.CreateIterator() );
+      }
+   }
+
+   template< class I >
+   static d::optional< DecayValueType > SumOrNone( const I& iterator )
+   {
+      d::optional< DecayValueType > ret;
+      d::Drain( iterator, [ & ]( auto&& v ) {
+         if( !ret.is_initialized() )
          {
-            break;
+            ret = DecayValueType{};
          }
-      }
+         ret.value() = ret.value() + v;
+      } );
       return ret;
    }
 
+   // The partial sums of a parallel pipeline are added in chunk order, so the result doesn't depend on the scheduling.
    d::optional< DecayValueType > SumOrNone() const
    {
       d::optional< DecayValueType > ret;
-      for( auto it = this->mShim.CreateIterator();; )
+      if constexpr( IsSimd< DecayT, DecayValueType >::value )
       {
-         auto result = it.Next();
-         if( result.is_initialized() )
+         if( auto size = this->mShim.Size() )
+         {
+            ret = simd::Sum( this->mShim.Data(), size );
+         }
+         return ret;
+      }
+      else if constexpr( IsPartitioned< DecayT >::value )
+      {
+         std::vector< d::optional< DecayValueType > > partials( this->mShim.GetPartitioning().Chunks() );
+         ParallelFor( this->mShim, [ & ]( const auto& iterator, size_t chunk ) { partials[ chunk ] = SumOrNone( iterator ); } );
+         for( auto& partial : partials )
          {
+            if( !partial.is_initialized() )
+            {
+               continue;
+            }
             if( !ret.is_initialized() )
             {
-               ret = DecayValueType{};
+               ret = std::move( partial );
+            }
+            else
+            {
+               ret.value() = ret.value() + partial.value();
             }
-            ret.value() = ret.value() + result.value();
-         }
-         else
-         {
-            break;
          }
+         return ret;
+      }
+      else
+      {
+         return SumOrNone( this->mShim.CreateIterator() );
       }
-      return ret;
    }
 
    DecayValueType Sum() const
@@ -1157,6 +4021,16 @@ struct Shim : ShimBase< T >
    {
       optional< V > ret;
 
+      if constexpr( IsRandomAccess< DecayT >::value )
+      {
+         auto size = this->mShim.Size();
+         if( size != 0 )
+         {
+            ret.emplace( this->mShim.At( size - 1 ) );
+         }
+         return ret;
+      }
+
       for( auto iterator = this->mShim.CreateIterator();; )
       {
          auto result = iterator.Next();
@@ -1216,6 +4090,40 @@ struct Shim : ShimBase< T >
       return std::move( result ).value();
    }
 
+   template< typename V = DecayValueType >
+   optional< V > ElementAtOrNone( size_t i ) const
+   {
+      optional< V > ret;
+
+      if constexpr( IsRandomAccess< DecayT >::value )
+      {
+         if( i < this->mShim.Size() )
+         {
+            ret.emplace( this->mShim.At( i ) );
+         }
+         return ret;
+      }
+
+      auto iterator = this->mShim.CreateIterator();
+      d::Advance( iterator, i );
+      auto result = iterator.Next();
+      if( result.is_initialized() )
+      {
+         ret.emplace( std::move( result ).value() );
+      }
+      return ret;
+   }
+
+   ValueType ElementAt( size_t i ) const
+   {
+      auto result = ElementAtOrNone< ValueType >( i );
+      if( !result.is_initialized() )
+      {
+         throw std::out_of_range( "The element isn't found." );
+      }
+      return std::move( result ).value();
+   }
+
    template< typename V = DecayValueType >
    optional< V > SingleOrNone() const
    {
@@ -1284,22 +4192,20 @@ struct Shim : ShimBase< T >
    optional< V > MinOrNone() const
    {
       optional< V > ret;
-
-      for( auto iterator = this->mShim.CreateIterator();; )
+      if constexpr( IsSimd< DecayT, DecayValueType >::value )
       {
-         auto result = iterator.Next();
-         if( result.is_initialized() )
+         if( auto size = this->mShim.Size() )
          {
-            if( !ret.is_initialized() || ret.value() > result.value() )
-            {
-               ret.emplace( std::move( result ).value() );
-            }
+            ret.emplace( this->mShim.At( simd::MinIndex( this->mShim.Data(), size ) ) );
          }
-         else
+         return ret;
+      }
+      d::Drain( this->mShim.CreateIterator(), [ & ]( auto&& v ) {
+         if( !ret.is_initialized() || ret.value() > v )
          {
-            break;
+            ret.emplace( std::forward< decltype( v ) >( v ) );
          }
-      }
+      } );
       return ret;
    }
 
@@ -1317,22 +4223,20 @@ struct Shim : ShimBase< T >
    optional< V > MaxOrNone() const
    {
       optional< V > ret;
-
-      for( auto iterator = this->mShim.CreateIterator();; )
+      if constexpr( IsSimd< DecayT, DecayValueType >::value )
       {
-         auto result = iterator.Next();
-         if( result.is_initialized() )
+         if( auto size = this->mShim.Size() )
          {
-            if( !ret.is_initialized() || ret.value() < result.value() )
-            {
-               ret.emplace( std::move( result ).value() );
-            }
+            ret.emplace( this->mShim.At( simd::MaxIndex( this->mShim.Data(), size ) ) );
          }
-         else
+         return ret;
+      }
+      d::Drain( this->mShim.CreateIterator(), [ & ]( auto&& v ) {
+         if( !ret.is_initialized() || ret.value() < v )
          {
-            break;
+            ret.emplace( std::forward< decltype( v ) >( v ) );
          }
-      }
+      } );
       return ret;
    }
 
@@ -1346,38 +4250,132 @@ struct Shim : ShimBase< T >
       return std::move( result ).value();
    }
 
+   // The k first elements in the order of less, sorted. A bounded heap keeps the memory at O( k ) and the time at
+   // O( n log k ); a parallel pipeline merges the heaps of its chunks.
+   template< typename C >
+   std::vector< DecayValueType > BottomK( size_t k, C&& less ) const
+   {
+      std::vector< DecayValueType > ret;
+      if( k == 0 )
+      {
+         return ret;
+      }
+      ret.reserve( std::min( k, GetCapacity() ) );
+      if constexpr( IsPartitioned< DecayT >::value )
+      {
+         std::mutex mutex;
+         ParallelFor( this->mShim, [ & ]( const auto& iterator, size_t ) {
+            std::vector< DecayValueType > heap;
+            d::HeapSelect( iterator, k, less, heap );
+            std::lock_guard< std::mutex > lock( mutex );
+            for( auto& m : heap )
+            {
+               d::HeapPush( ret, k, std::move( m ), less );
+            }
+         } );
+      }
+      else
+      {
+         d::HeapSelect( this->mShim.CreateIterator(), k, less, ret );
+      }
+      std::sort_heap( ret.begin(), ret.end(), less );
+      return ret;
+   }
+
+   std::vector< DecayValueType > BottomK( size_t k ) const
+   {
+      return BottomK( k, std::less<>() );
+   }
+
+   // The k last elements in the order of less, the last one first.
+   template< typename C >
+   std::vector< DecayValueType > TopK( size_t k, C&& less ) const
+   {
+      return BottomK( k, [ & ]( auto& a, auto& b ) { return less( b, a ); } );
+   }
+
+   std::vector< DecayValueType > TopK( size_t k ) const
+   {
+      return BottomK( k, std::greater<>() );
+   }
+
    template< typename A, typename F >
    A Aggregate( A a, F&& f ) const
    {
-      for( auto iterator = this->mShim.CreateIterator();; )
+      d::ForEach( this->mShim.CreateIterator(), [ & ]( auto&& v ) {
+         a = f( a, std::forward< decltype( v ) >( v ) );
+         return true;
+      } );
+      return a;
+   }
+
+   // Each chunk of a parallel pipeline folds its elements into a copy of a, then combine folds the partial results in
+   // chunk order; a should be the identity of combine. A sequential pipeline ignores combine.
+   template< typename A, typename F, typename C >
+   A Aggregate( A a, F&& f, C&& combine ) const
+   {
+      if constexpr( IsPartitioned< DecayT >::value )
       {
-         auto result = iterator.Next();
-         if( result.is_initialized() )
-         {
-            a = f( a, std::move( result ).value() );
-         }
-         else
+         // Not a vector: vector< bool > would pack the partials of different threads into one word.
+         std::deque< A > partials( this->mShim.GetPartitioning().Chunks(), a );
+         ParallelFor( this->mShim, [ & ]( const auto& iterator, size_t chunk ) {
+            auto partial = partials[ chunk ];
+            d::ForEach( iterator, [ & ]( auto&& v ) {
+               partial = f( partial, std::forward< decltype( v ) >( v ) );
+               return true;
+            } );
+            partials[ chunk ] = std::move( partial );
+         } );
+         auto ret = std::move( partials.front() );
+         for( size_t i = 1; i < partials.size(); ++i )
          {
-            break;
+            ret = combine( std::move( ret ), std::move( partials[ i ] ) );
          }
+         return ret;
+      }
+      else
+      {
+         return Aggregate( std::move( a ), std::forward< F >( f ) );
       }
-      return a;
    }
 
    bool Any() const
    {
-      return this->mShim.CreateIterator().Next().is_initialized();
+      return !d::ForEach( this->mShim.CreateIterator(), []( auto&& ) { return false; } );
    }
 
    template< typename F >
    bool Any( F&& f ) const
    {
-      return this->Ref().Where( std::forward< F >( f ) ).Any();
+      if constexpr( IsPartitioned< DecayT >::value )
+      {
+         std::atomic< bool > found{ false };
+         ParallelFor( this->mShim, [ & ]( const auto& iterator, size_t ) {
+            d::ForEach( iterator, [ & ]( auto&& v ) -> bool {
+               if( found.load( std::memory_order_relaxed ) )
+               {
+                  return false;
+               }
+               if( f( v ) )
+               {
+                  found = true;
+                  return false;
+               }
+               return true;
+            } );
+         } );
+         return found;
+      }
+      return !d::ForEach( this->mShim.CreateIterator(), [ & ]( auto&& v ) -> bool { return !f( v ); } );
    }
 
    template< typename F >
    bool All( F&& f ) const
    {
+      if constexpr( IsPartitioned< DecayT >::value )
+      {
+         return !Any( [ & ]( const auto& m ) { return !f( m ); } );
+      }
       auto empty = true;
       return !Any( [ & ]( const auto& m ) { empty = false; return !f( m ); } ) ||
              empty;
@@ -1386,50 +4384,114 @@ struct Shim : ShimBase< T >
    template< typename V >
    bool Contains( const V& v ) const
    {
-      for( auto iterator = this->mShim.CreateIterator();; )
+      if constexpr( IsSimd< DecayT, DecayValueType >::value && std::is_same< V, DecayValueType >::value )
       {
-         auto result = iterator.Next();
-         if( result.is_initialized() )
-         {
-            if( result.value() == v )
-            {
-               return true;
-            }
-         }
-         else
-         {
-            break;
-         }
+         auto size = this->mShim.Size();
+         return simd::Find( this->mShim.Data(), size, v ) != size;
       }
-      return false;
+      return !d::ForEach( this->mShim.CreateIterator(), [ & ]( auto&& m ) -> bool { return !( m == v ); } );
    }
 
+   // The number of elements that c contains too, counting no further than limit. Two AsSorted() sides are merged, a side of
+   // at most TinyMax elements is scanned by Contains(), and otherwise the side with the smaller GetCapacity() is hashed.
    template< typename C >
-   bool IsIntersect( const C& c ) const
+   size_t CountCommon( const C& c, size_t limit ) const
    {
-      auto container = From( c );
-      for( auto iterator = this->mShim.CreateIterator();; )
+      constexpr size_t TinyMax = 16;
+
+      size_t ret = 0;
+      if constexpr( IsIndex< C >::value )
       {
-         auto result = iterator.Next();
-         if( !result.is_initialized() )
+         d::ForEach( this->mShim.CreateIterator(), [ & ]( auto&& v ) {
+            ret += c.Contains( v ) ? 1 : 0;
+            return ret < limit;
+         } );
+         return ret;
+      }
+      else
+      {
+         auto other = From( c );
+         using Other = decltype( other );
+         using Key = std::common_type_t< DecayValueType, typename Other::DecayValueType >;
+
+         if constexpr( IsSorted< DecayT >::value && IsSorted< typename Other::DecayT >::value )
          {
-            break;
+            auto a = this->mShim.CreateIterator();
+            auto b = other.mShim.CreateIterator();
+            auto x = a.Next();
+            auto y = b.Next();
+            while( x.is_initialized() && y.is_initialized() && ret < limit )
+            {
+               if( y.value() < x.value() )
+               {
+                  y = b.Next();
+               }
+               else
+               {
+                  ret += x.value() < y.value() ? 0 : 1;
+                  x = a.Next();
+               }
+            }
+            return ret;
          }
-
-         for( auto iterator2 = container.mShim.CreateIterator();; )
+         else
          {
-            auto result2 = iterator2.Next();
-            if( !result2.is_initialized() )
+            auto hint = this->mShim.GetSizeHint();
+            auto otherHint = other.mShim.GetSizeHint();
+            if( hint.mUpper <= TinyMax || otherHint.mUpper <= TinyMax )
             {
-               break;
+               d::ForEach( this->mShim.CreateIterator(), [ & ]( auto&& v ) {
+                  ret += other.Contains( v ) ? 1 : 0;
+                  return ret < limit;
+               } );
             }
-            if( result.value() == result2.value() )
+            else if( GetCapacity() < other.GetCapacity() )
             {
-               return true;
+               // Each key counts its occurrences here once, at its first occurrence in c.
+               FlatHashMap< Key, size_t > table;
+               table.Reserve( GetCapacity() );
+               Index( table, this->mShim.CreateIterator(), sort::Identity{}, []( size_t& n, auto&& ) { ++n; } );
+               d::ForEach( other.mShim.CreateIterator(), [ & ]( auto&& v ) {
+                  if( auto n = table.Find( v ) )
+                  {
+                     ret += std::exchange( *n, 0 );
+                  }
+                  return ret < limit;
+               } );
             }
+            else
+            {
+               FlatHashMap< Key, bool > table;
+               table.Reserve( other.GetCapacity() );
+               Index( table, other.mShim.CreateIterator(), sort::Identity{}, []( bool&, auto&& ) {} );
+               d::ForEach( this->mShim.CreateIterator(), [ & ]( auto&& v ) {
+                  ret += table.Find( v ) != nullptr ? 1 : 0;
+                  return ret < limit;
+               } );
+            }
+            return ret;
          }
       }
-      return false;
+   }
+
+   template< typename C >
+   bool IsIntersect( const C& c ) const
+   {
+      return CountCommon( c, 1 ) != 0;
+   }
+
+   // Whether at least n elements are in c; stops at the n-th.
+   template< typename C >
+   bool Overlaps( const C& c, size_t n = 1 ) const
+   {
+      return CountCommon( c, n ) >= n;
+   }
+
+   // The number of elements that c contains too, as Intersect( c ).Count().
+   template< typename C >
+   size_t IntersectCount( const C& c ) const
+   {
+      return CountCommon( c, std::numeric_limits< size_t >::max() );
    }
 };
 
@@ -1440,24 +4502,45 @@ struct StdShim
    using iterator = typename DecayT::iterator;
    using const_iterator = typename DecayT::const_iterator;
 
+   static constexpr bool Stable = true;
+
    T mContainer;
 
-   using Iterator = StdItAdr< decltype( std::begin( mContainer ) ) >;
+   using StdIterator = decltype( std::begin( mContainer ) );
+   using Iterator = StdItAdr< StdIterator, IsContiguousIterator< StdIterator >::value || IsContiguousContainer< DecayT >::value >;
 
-   size_t GetCapacity() const
+   SizeHint GetSizeHint() const
    {
-      return mContainer.size();
+      return SizeHint::Exact( mContainer.size() );
    }
 
    Iterator CreateIterator()
    {
-      return MakeIterator( std::begin( mContainer ), std::end( mContainer ) );
+      return { std::begin( mContainer ), std::end( mContainer ) };
    };
 
    Iterator CreateIterator() const
    {
       return const_cast< StdShim* >( this )->CreateIterator();
    };
+
+   template< class I = StdIterator, std::enable_if_t< IsRandomAccessIterator< I >::value, int > = 0 >
+   size_t Size() const
+   {
+      return mContainer.size();
+   }
+
+   template< class I = StdIterator, std::enable_if_t< IsRandomAccessIterator< I >::value, int > = 0 >
+   typename Iterator::ReferenceType At( size_t i ) const
+   {
+      return static_cast< typename Iterator::ReferenceType >( std::begin( const_cast< StdShim* >( this )->mContainer )[ i ] );
+   }
+
+   template< class I = StdIterator, std::enable_if_t< IsContiguousIterator< I >::value || IsContiguousContainer< DecayT >::value, int > = 0 >
+   auto Data() const
+   {
+      return std::data( const_cast< StdShim* >( this )->mContainer );
+   }
 };
 
 template< class I >
@@ -1466,21 +4549,49 @@ struct StdItShim
    using iterator = I;
    using const_iterator = I;
 
+   // An input iterator may hand out a reference to a value of its own, which the next increment replaces.
+   static constexpr bool Stable = std::is_base_of< std::forward_iterator_tag, typename std::iterator_traits< I >::iterator_category >::value;
+
    I mEnd;
    I mBegin;
    size_t mCapacity;
 
    using Iterator = StdItAdr< I >;
 
-   size_t GetCapacity() const
+   SizeHint GetSizeHint() const
    {
-      return mCapacity;
+      if constexpr( IsRandomAccessIterator< I >::value )
+      {
+         return SizeHint::Exact( static_cast< size_t >( mEnd - mBegin ) );
+      }
+      else
+      {
+         return SizeHint::Guess( mCapacity );
+      }
    }
 
    Iterator CreateIterator() const
    {
       return MakeIterator( mBegin, mEnd );
    };
+
+   template< class J = I, std::enable_if_t< IsRandomAccessIterator< J >::value, int > = 0 >
+   size_t Size() const
+   {
+      return static_cast< size_t >( mEnd - mBegin );
+   }
+
+   template< class J = I, std::enable_if_t< IsRandomAccessIterator< J >::value, int > = 0 >
+   typename Iterator::ReferenceType At( size_t i ) const
+   {
+      return static_cast< typename Iterator::ReferenceType >( mBegin[ i ] );
+   }
+
+   template< class J = I, std::enable_if_t< IsContiguousIterator< J >::value, int > = 0 >
+   auto Data() const
+   {
+      return mBegin == mEnd ? nullptr : std::addressof( *mBegin );
+   }
 };
 
 template< class F, class V >
@@ -1506,6 +4617,39 @@ struct FnShim
          return {};
       }
 
+      template< class S >
+      bool ForEach( S&& s ) const
+      {
+         for( ;; )
+         {
+            auto ret = mFn();
+            if( !UnwrapReferenceV( ret ) )
+            {
+               return true;
+            }
+            if( !s( ConvertV< V >( *UnwrapReferenceV( std::move( ret ) ) ) ) )
+            {
+               return false;
+            }
+         }
+      }
+
+      template< class B >
+      size_t NextBatch( B& b ) const
+      {
+         b.Clear();
+         while( !b.Full() )
+         {
+            auto ret = mFn();
+            if( !UnwrapReferenceV( ret ) )
+            {
+               break;
+            }
+            b.Push( ConvertV< V >( *UnwrapReferenceV( std::move( ret ) ) ) );
+         }
+         return b.Size();
+      }
+
       bool operator==( const FnItShim& ) const
       {
          return false;
@@ -1517,9 +4661,9 @@ struct FnShim
    size_t mCapacity;
    mutable F mFn;
 
-   size_t GetCapacity() const
+   SizeHint GetSizeHint() const
    {
-      return mCapacity;
+      return SizeHint::Guess( mCapacity );
    }
 
    Iterator CreateIterator()
@@ -1533,6 +4677,46 @@ struct FnShim
    };
 };
 
+struct SplitShim
+{
+   struct Iterator
+   {
+      using ResultType = optional< std::string_view >;
+
+      using pointer = typename ResultType::pointer_type;
+      using value_type = typename ResultType::value_type;
+      using reference = typename ResultType::reference_type;
+
+      mutable Splitter mSplitter;
+
+      ResultType Next() const
+      {
+         return mSplitter.Next();
+      }
+
+      bool operator==( const Iterator& i ) const
+      {
+         return mSplitter.mPosition == i.mSplitter.mPosition;
+      }
+   };
+
+   std::string_view mBuffer;
+   std::string mDelimiters;
+
+   SizeHint GetSizeHint() const
+   {
+      if( mBuffer.empty() || mDelimiters.empty() )
+      {
+         return SizeHint::Exact( mBuffer.empty() ? 0 : 1 );
+      }
+      return { 1, mBuffer.size() + 1, false };
+   }
+
+   Iterator CreateIterator() const
+   {
+      return { { mBuffer, mDelimiters } };
+   }
+};
 } // namespace d
 
 template< class T >
@@ -1565,6 +4749,18 @@ d::Shim< d::FnShim< F, V > > From( F f, size_t capacity )
    return From< V, F >( std::move( f ), capacity );
 }
 
+// The tokens of buffer between the delimiters, without copies; buffer must outlive the query.
+inline d::Shim< d::SplitShim > Split( std::string_view buffer, char delimiter )
+{
+   return { { buffer, std::string( 1, delimiter ) } };
+}
+
+// Any byte of delimiters ends a token.
+inline d::Shim< d::SplitShim > Split( std::string_view buffer, std::string_view delimiters )
+{
+   return { { buffer, std::string( delimiters ) } };
+}
+
 template< typename P, size_t N >
 constexpr auto From( P ( &p )[ N ] )
 {
@@ -1,26 +1,574 @@
-// https://github.com/DevUtilsNet/linqcpp
-// Copyright (C) 2018 Kapitonov Maxim
-//
-// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
-// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
-// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
-// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
-//
-
-#pragma once
-
-#include <boost/optional.hpp>
-
-namespace linq
-{
-namespace d
-{
-template< class T >
-using optional = boost::optional< T >;
-}
-} // namespace linq
\ No newline at end of file
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2018 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+// d::optional backend:
+//   default                    - d::Optional, the library's own optional
+//   LINQCPP_OPTIONAL_BOOST     - boost::optional
+//   LINQCPP_OPTIONAL_STD       - std::optional for values, d::Optional for references
+
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined( LINQCPP_OPTIONAL_BOOST )
+#include <boost/optional.hpp>
+#elif defined( LINQCPP_OPTIONAL_STD )
+#include <optional>
+#endif
+
+#if defined( __GNUC__ ) || defined( __clang__ )
+#define LINQCPP_LIKELY( x ) __builtin_expect( !!( x ), 1 )
+#define LINQCPP_UNLIKELY( x ) __builtin_expect( !!( x ), 0 )
+#define LINQCPP_ASSUME( x ) \
+   do                       \
+   {                        \
+      if( !( x ) )          \
+      {                     \
+         __builtin_unreachable(); \
+      }                     \
+   } while( false )
+#elif defined( _MSC_VER )
+#define LINQCPP_LIKELY( x ) ( x )
+#define LINQCPP_UNLIKELY( x ) ( x )
+#define LINQCPP_ASSUME( x ) __assume( x )
+#else
+#define LINQCPP_LIKELY( x ) ( x )
+#define LINQCPP_UNLIKELY( x ) ( x )
+#define LINQCPP_ASSUME( x ) ( (void)0 )
+#endif
+
+namespace linq
+{
+namespace d
+{
+struct BadOptionalAccess : std::logic_error
+{
+   BadOptionalAccess()
+      : std::logic_error( "Attempted to access the value of an uninitialized optional object." )
+   {
+   }
+};
+
+[[noreturn]] inline void ThrowBadOptionalAccess()
+{
+   throw BadOptionalAccess{};
+}
+
+template< class T, bool = std::is_trivially_destructible< T >::value >
+struct OptionalStorage
+{
+   union
+   {
+      char mNone;
+      T mValue;
+   };
+   bool mInitialized;
+
+   constexpr OptionalStorage() noexcept
+      : mNone{}
+      , mInitialized{ false }
+   {
+   }
+
+   void Destroy() noexcept
+   {
+      mInitialized = false;
+   }
+};
+
+template< class T >
+struct OptionalStorage< T, false >
+{
+   union
+   {
+      char mNone;
+      T mValue;
+   };
+   bool mInitialized;
+
+   constexpr OptionalStorage() noexcept
+      : mNone{}
+      , mInitialized{ false }
+   {
+   }
+
+   ~OptionalStorage()
+   {
+      Destroy();
+   }
+
+   void Destroy() noexcept
+   {
+      if( mInitialized )
+      {
+         mValue.~T();
+         mInitialized = false;
+      }
+   }
+};
+
+// Trivially copyable values keep the trivial copy of the union, so the optional stays trivially copyable.
+template< class T, bool = std::is_trivially_copyable< T >::value >
+struct OptionalCopy : OptionalStorage< T >
+{
+   template< class... A >
+   void Construct( A&&... a )
+   {
+      new( std::addressof( this->mValue ) ) T( std::forward< A >( a )... );
+      this->mInitialized = true;
+   }
+
+   template< class U >
+   void Assign( U&& u )
+   {
+      if( this->mInitialized )
+      {
+         this->mValue = std::forward< U >( u );
+      }
+      else
+      {
+         Construct( std::forward< U >( u ) );
+      }
+   }
+};
+
+template< class T >
+struct OptionalCopy< T, false > : OptionalStorage< T >
+{
+   OptionalCopy() = default;
+
+   OptionalCopy( const OptionalCopy& o )
+   {
+      if( o.mInitialized )
+      {
+         Construct( o.mValue );
+      }
+   }
+
+   OptionalCopy( OptionalCopy&& o ) noexcept( std::is_nothrow_move_constructible< T >::value )
+   {
+      if( o.mInitialized )
+      {
+         Construct( std::move( o.mValue ) );
+      }
+   }
+
+   OptionalCopy& operator=( const OptionalCopy& o )
+   {
+      if( o.mInitialized )
+      {
+         Assign( o.mValue );
+      }
+      else
+      {
+         this->Destroy();
+      }
+      return *this;
+   }
+
+   OptionalCopy& operator=( OptionalCopy&& o ) noexcept( std::is_nothrow_move_constructible< T >::value && std::is_nothrow_move_assignable< T >::value )
+   {
+      if( o.mInitialized )
+      {
+         Assign( std::move( o.mValue ) );
+      }
+      else
+      {
+         this->Destroy();
+      }
+      return *this;
+   }
+
+   template< class... A >
+   void Construct( A&&... a )
+   {
+      new( std::addressof( this->mValue ) ) T( std::forward< A >( a )... );
+      this->mInitialized = true;
+   }
+
+   template< class U >
+   void Assign( U&& u )
+   {
+      if( this->mInitialized )
+      {
+         this->mValue = std::forward< U >( u );
+      }
+      else
+      {
+         Construct( std::forward< U >( u ) );
+      }
+   }
+};
+
+template< class T >
+struct Optional : OptionalCopy< T >
+{
+   using value_type = T;
+   using reference_type = T&;
+   using reference_const_type = const T&;
+   using rval_reference_type = T&&;
+   using pointer_type = T*;
+   using pointer_const_type = const T*;
+
+   constexpr Optional() noexcept = default;
+
+   Optional( const T& v )
+   {
+      this->Construct( v );
+   }
+
+   Optional( T&& v )
+   {
+      this->Construct( std::move( v ) );
+   }
+
+   template< class U, std::enable_if_t< !std::is_same< U, T >::value && std::is_constructible< T, const U& >::value, int > = 0 >
+   explicit Optional( const Optional< U >& o )
+   {
+      if( o.is_initialized() )
+      {
+         this->Construct( *o );
+      }
+   }
+
+   template< class U, std::enable_if_t< !std::is_same< U, T >::value && std::is_constructible< T, U&& >::value, int > = 0 >
+   explicit Optional( Optional< U >&& o )
+   {
+      if( o.is_initialized() )
+      {
+         this->Construct( *std::move( o ) );
+      }
+   }
+
+   Optional& operator=( const T& v )
+   {
+      this->Assign( v );
+      return *this;
+   }
+
+   Optional& operator=( T&& v )
+   {
+      this->Assign( std::move( v ) );
+      return *this;
+   }
+
+   bool is_initialized() const noexcept
+   {
+      return this->mInitialized;
+   }
+
+   bool has_value() const noexcept
+   {
+      return this->mInitialized;
+   }
+
+   explicit operator bool() const noexcept
+   {
+      return this->mInitialized;
+   }
+
+   bool operator!() const noexcept
+   {
+      return !this->mInitialized;
+   }
+
+   T& operator*() & noexcept
+   {
+      LINQCPP_ASSUME( this->mInitialized );
+      return this->mValue;
+   }
+
+   const T& operator*() const& noexcept
+   {
+      LINQCPP_ASSUME( this->mInitialized );
+      return this->mValue;
+   }
+
+   T&& operator*() && noexcept
+   {
+      LINQCPP_ASSUME( this->mInitialized );
+      return std::move( this->mValue );
+   }
+
+   T* operator->() noexcept
+   {
+      return std::addressof( this->mValue );
+   }
+
+   const T* operator->() const noexcept
+   {
+      return std::addressof( this->mValue );
+   }
+
+   T& get() & noexcept
+   {
+      return **this;
+   }
+
+   const T& get() const& noexcept
+   {
+      return **this;
+   }
+
+   T* get_ptr() noexcept
+   {
+      return this->mInitialized ? std::addressof( this->mValue ) : nullptr;
+   }
+
+   const T* get_ptr() const noexcept
+   {
+      return this->mInitialized ? std::addressof( this->mValue ) : nullptr;
+   }
+
+   T& value() &
+   {
+      if( LINQCPP_UNLIKELY( !this->mInitialized ) )
+      {
+         ThrowBadOptionalAccess();
+      }
+      return this->mValue;
+   }
+
+   const T& value() const&
+   {
+      if( LINQCPP_UNLIKELY( !this->mInitialized ) )
+      {
+         ThrowBadOptionalAccess();
+      }
+      return this->mValue;
+   }
+
+   T&& value() &&
+   {
+      if( LINQCPP_UNLIKELY( !this->mInitialized ) )
+      {
+         ThrowBadOptionalAccess();
+      }
+      return std::move( this->mValue );
+   }
+
+   template< class U >
+   T value_or( U&& u ) const&
+   {
+      return this->mInitialized ? this->mValue : static_cast< T >( std::forward< U >( u ) );
+   }
+
+   template< class U >
+   T value_or( U&& u ) &&
+   {
+      return this->mInitialized ? std::move( this->mValue ) : static_cast< T >( std::forward< U >( u ) );
+   }
+
+   template< class... A >
+   T& emplace( A&&... a )
+   {
+      this->Destroy();
+      this->Construct( std::forward< A >( a )... );
+      return this->mValue;
+   }
+
+   void reset() noexcept
+   {
+      this->Destroy();
+   }
+};
+
+// A reference is stored as a pointer; the null pointer is the empty state.
+template< class T >
+struct Optional< T& >
+{
+   using value_type = T&;
+   using reference_type = T&;
+   using reference_const_type = T&;
+   using rval_reference_type = T&;
+   using pointer_type = T*;
+   using pointer_const_type = T*;
+
+   T* mPointer = nullptr;
+
+   constexpr Optional() noexcept = default;
+
+   constexpr Optional( T& v ) noexcept
+      : mPointer{ std::addressof( v ) }
+   {
+   }
+
+   Optional( T&& ) = delete;
+
+   template< class U, std::enable_if_t< !std::is_same< U, T >::value && std::is_convertible< U*, T* >::value, int > = 0 >
+   constexpr Optional( const Optional< U& >& o ) noexcept
+      : mPointer{ o.mPointer }
+   {
+   }
+
+   constexpr bool is_initialized() const noexcept
+   {
+      return mPointer != nullptr;
+   }
+
+   constexpr bool has_value() const noexcept
+   {
+      return mPointer != nullptr;
+   }
+
+   constexpr explicit operator bool() const noexcept
+   {
+      return mPointer != nullptr;
+   }
+
+   constexpr bool operator!() const noexcept
+   {
+      return mPointer == nullptr;
+   }
+
+   T& operator*() const noexcept
+   {
+      LINQCPP_ASSUME( mPointer != nullptr );
+      return *mPointer;
+   }
+
+   T* operator->() const noexcept
+   {
+      return mPointer;
+   }
+
+   T& get() const noexcept
+   {
+      return **this;
+   }
+
+   T* get_ptr() const noexcept
+   {
+      return mPointer;
+   }
+
+   T& value() const
+   {
+      if( LINQCPP_UNLIKELY( mPointer == nullptr ) )
+      {
+         ThrowBadOptionalAccess();
+      }
+      return *mPointer;
+   }
+
+   T& value_or( T& v ) const noexcept
+   {
+      return mPointer ? *mPointer : v;
+   }
+
+   T& emplace( T& v ) noexcept
+   {
+      mPointer = std::addressof( v );
+      return v;
+   }
+
+   void emplace( T&& ) = delete;
+
+   void reset() noexcept
+   {
+      mPointer = nullptr;
+   }
+};
+
+template< class T, class U >
+bool operator==( const Optional< T >& a, const Optional< U >& b )
+{
+   if( a.is_initialized() != b.is_initialized() )
+   {
+      return false;
+   }
+   return !a.is_initialized() || *a == *b;
+}
+
+template< class T, class U >
+bool operator!=( const Optional< T >& a, const Optional< U >& b )
+{
+   return !( a == b );
+}
+
+#if defined( LINQCPP_OPTIONAL_BOOST )
+
+template< class T >
+using optional = boost::optional< T >;
+
+#elif defined( LINQCPP_OPTIONAL_STD )
+
+template< class T >
+struct StdOptional : std::optional< T >
+{
+   using value_type = T;
+   using reference_type = T&;
+   using reference_const_type = const T&;
+   using rval_reference_type = T&&;
+   using pointer_type = T*;
+   using pointer_const_type = const T*;
+
+   using std::optional< T >::optional;
+
+   StdOptional() = default;
+
+   template< class U,
+             std::enable_if_t< !std::is_base_of< std::optional< T >, std::decay_t< U > >::value && std::is_constructible< T, U&& >::value, int > = 0 >
+   StdOptional& operator=( U&& u )
+   {
+      std::optional< T >::operator=( std::forward< U >( u ) );
+      return *this;
+   }
+
+   template< class U, std::enable_if_t< std::is_constructible< T, U& >::value, int > = 0 >
+   explicit StdOptional( const Optional< U& >& o )
+   {
+      if( o.is_initialized() )
+      {
+         this->emplace( *o );
+      }
+   }
+
+   bool is_initialized() const noexcept
+   {
+      return this->has_value();
+   }
+
+   friend bool operator==( const StdOptional& a, const StdOptional& b )
+   {
+      return static_cast< const std::optional< T >& >( a ) == static_cast< const std::optional< T >& >( b );
+   }
+
+   friend bool operator!=( const StdOptional& a, const StdOptional& b )
+   {
+      return !( a == b );
+   }
+};
+
+template< class T >
+struct StdOptional< T& > : Optional< T& >
+{
+   using Optional< T& >::Optional;
+};
+
+template< class T >
+using optional = StdOptional< T >;
+
+#else
+
+template< class T >
+using optional = Optional< T >;
+
+#endif
+} // namespace d
+} // namespace linq
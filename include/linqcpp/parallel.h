@@ -0,0 +1,280 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+
+// AsParallel() splits a random access source into chunks. Where, Select, SelectWhere and SelectMany run chunk by chunk
+// on a work stealing pool, and Count, Sum, Aggregate, ToVector, ToUnorderedSet, Any and All reduce the partial results
+// of the chunks. The functors of a parallel pipeline are called concurrently and must be thread safe.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace linq
+{
+namespace d
+{
+class ThreadPool
+{
+public:
+   using Job = std::function< void() >;
+
+   explicit ThreadPool( size_t size )
+      : mQueues( size )
+   {
+      for( size_t i = 0; i < size; ++i )
+      {
+         mThreads.emplace_back( [ this, i ] { Loop( i ); } );
+      }
+   }
+
+   ThreadPool( const ThreadPool& ) = delete;
+   ThreadPool& operator=( const ThreadPool& ) = delete;
+
+   ~ThreadPool()
+   {
+      {
+         std::lock_guard< std::mutex > lock( mMutex );
+         mStop = true;
+      }
+      mCondition.notify_all();
+      for( auto& thread : mThreads )
+      {
+         thread.join();
+      }
+   }
+
+   static ThreadPool& Default()
+   {
+      static ThreadPool pool( std::max( std::thread::hardware_concurrency(), 1u ) );
+      return pool;
+   }
+
+   size_t Size() const
+   {
+      return mThreads.size();
+   }
+
+   // A worker pushes onto its own queue, other threads spread the jobs round robin.
+   void Push( Job job )
+   {
+      auto i = Current() < mQueues.size() ? Current() : mNext++ % mQueues.size();
+      {
+         std::lock_guard< std::mutex > lock( mQueues[ i ].mMutex );
+         mQueues[ i ].mJobs.push_back( std::move( job ) );
+      }
+      {
+         std::lock_guard< std::mutex > lock( mMutex );
+         ++mPending;
+      }
+      mCondition.notify_one();
+   }
+
+   // Calls f( 0 ) ... f( count - 1 ) on up to degree threads, the calling one included, and returns when all calls are done.
+   // Rethrows the first exception; the calls not started by then are skipped.
+   template< class F >
+   void For( size_t count, size_t degree, F&& f )
+   {
+      struct State
+      {
+         std::atomic< size_t > mNext{ 0 };
+         std::atomic< bool > mStop{ false };
+         size_t mDone = 0;
+         std::exception_ptr mException;
+         std::mutex mMutex;
+         std::condition_variable mCondition;
+      };
+
+      // Late helpers find no chunk left and only touch the state, which they share.
+      auto state = std::make_shared< State >();
+      auto run = [ count, state, &f ] {
+         for( size_t i; ( i = state->mNext++ ) < count; )
+         {
+            std::exception_ptr exception;
+            if( !state->mStop )
+            {
+               try
+               {
+                  f( i );
+               }
+               catch( ... )
+               {
+                  exception = std::current_exception();
+                  state->mStop = true;
+               }
+            }
+            std::lock_guard< std::mutex > lock( state->mMutex );
+            if( exception && !state->mException )
+            {
+               state->mException = exception;
+            }
+            if( ++state->mDone == count )
+            {
+               state->mCondition.notify_all();
+            }
+         }
+      };
+
+      degree = std::min( { degree == 0 ? Size() : degree, Size() + 1, count } );
+      for( size_t i = 1; i < degree; ++i )
+      {
+         Push( run );
+      }
+      run();
+
+      std::unique_lock< std::mutex > lock( state->mMutex );
+      state->mCondition.wait( lock, [ & ] { return state->mDone == count; } );
+      if( state->mException )
+      {
+         std::rethrow_exception( state->mException );
+      }
+   }
+
+private:
+   struct Queue
+   {
+      std::mutex mMutex;
+      std::deque< Job > mJobs;
+   };
+
+   static size_t& Current()
+   {
+      static thread_local size_t current = static_cast< size_t >( -1 );
+      return current;
+   }
+
+   // Takes the newest job of the worker's own queue, otherwise steals the oldest one of another queue.
+   bool RunOne( size_t self )
+   {
+      Job job;
+      for( size_t k = 0; k < mQueues.size() && !job; ++k )
+      {
+         auto& queue = mQueues[ ( self + k ) % mQueues.size() ];
+         std::lock_guard< std::mutex > lock( queue.mMutex );
+         if( !queue.mJobs.empty() )
+         {
+            if( k == 0 )
+            {
+               job = std::move( queue.mJobs.back() );
+               queue.mJobs.pop_back();
+            }
+            else
+            {
+               job = std::move( queue.mJobs.front() );
+               queue.mJobs.pop_front();
+            }
+         }
+      }
+      if( !job )
+      {
+         return false;
+      }
+      {
+         std::lock_guard< std::mutex > lock( mMutex );
+         --mPending;
+      }
+      job();
+      return true;
+   }
+
+   void Loop( size_t self )
+   {
+      Current() = self;
+      for( ;; )
+      {
+         if( RunOne( self ) )
+         {
+            continue;
+         }
+         std::unique_lock< std::mutex > lock( mMutex );
+         mCondition.wait( lock, [ this ] { return mStop || mPending != 0; } );
+         if( mStop )
+         {
+            return;
+         }
+      }
+   }
+
+   std::vector< Queue > mQueues;
+   std::vector< std::thread > mThreads;
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   size_t mPending = 0;
+   bool mStop = false;
+   std::atomic< size_t > mNext{ 0 };
+};
+
+// How a parallel shim splits its mSize elements: about four chunks per thread, so that stealing evens out the load,
+// but no chunk shorter than MinChunk. A degree of zero means every thread of the pool.
+struct Partitioning
+{
+   static constexpr size_t MinChunk = 1024;
+
+   size_t mSize;
+   size_t mDegree;
+   bool mOrdered;
+
+   size_t Degree() const
+   {
+      return mDegree == 0 ? ThreadPool::Default().Size() : mDegree;
+   }
+
+   size_t Chunks() const
+   {
+      return std::max< size_t >( std::min( Degree() * 4, mSize / MinChunk ), 1 );
+   }
+
+   size_t Begin( size_t chunk ) const
+   {
+      return mSize * chunk / Chunks();
+   }
+
+   size_t End( size_t chunk ) const
+   {
+      return Begin( chunk + 1 );
+   }
+};
+
+template< class T, class = void >
+struct IsPartitioned : std::false_type
+{
+};
+
+template< class T >
+struct IsPartitioned< T, std::void_t< decltype( std::declval< const T& >().GetPartitioning() ) > > : std::true_type
+{
+};
+
+// Calls f( iterator, chunk ) for every chunk of a partitioned shim on the default pool.
+template< class T, class F >
+void ParallelFor( const T& shim, F&& f )
+{
+   auto partitioning = shim.GetPartitioning();
+   ThreadPool::Default().For( partitioning.Chunks(), partitioning.mDegree, [ & ]( size_t chunk ) {
+      f( shim.CreateIterator( partitioning.Begin( chunk ), partitioning.End( chunk ) ), chunk );
+   } );
+}
+} // namespace d
+} // namespace linq
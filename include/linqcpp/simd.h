@@ -0,0 +1,1326 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+// Kernels for terminal operators over contiguous spans of 32 and 64 bit arithmetic types, and for lane-wise Where, Select
+// and SelectWhere (see lanes.h) over float, double and 32 bit integers, and the byte scan behind Split().
+//   x86-64                     - SSE2, and AVX2 when the CPU supports it (checked once at run time with GCC and Clang,
+//                                at compile time with /arch:AVX2 on MSVC)
+//   other targets              - scalar
+//   LINQCPP_SIMD_DISABLE       - scalar everywhere
+//
+// Floating-point Sum() order: lane k of Lanes accumulates, in index order, the elements whose index is k modulo Lanes
+// among the first n - n % Lanes ones. The lanes are folded by halving (lane k with lane k + 8, then k + 4, k + 2, k + 1),
+// and the last n % Lanes elements are added to the result in index order. Every instruction set, including the scalar
+// one, follows this order, so the sum of the same span is bit-identical on every machine.
+
+#include "lanes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#include <intrin.h>
+#endif
+
+#if !defined( LINQCPP_SIMD_DISABLE ) && ( defined( __x86_64__ ) || defined( _M_X64 ) )
+#include <immintrin.h>
+#define LINQCPP_SIMD_SSE2
+#if defined( __AVX2__ )
+#define LINQCPP_SIMD_AVX2
+#elif defined( __GNUC__ ) || defined( __clang__ )
+#define LINQCPP_SIMD_AVX2
+#define LINQCPP_SIMD_AVX2_DISPATCH
+#endif
+#endif
+
+namespace linq
+{
+namespace d
+{
+namespace simd
+{
+constexpr size_t Lanes = 16;
+
+enum class Kind
+{
+   None,
+   F32,
+   F64,
+   I32,
+   U32,
+   I64,
+   U64
+};
+
+template< class T >
+constexpr Kind KindOf()
+{
+   if constexpr( std::is_same< T, float >::value )
+   {
+      return Kind::F32;
+   }
+   else if constexpr( std::is_same< T, double >::value )
+   {
+      return Kind::F64;
+   }
+   else if constexpr( !std::is_integral< T >::value || std::is_same< T, bool >::value )
+   {
+      return Kind::None;
+   }
+   else if constexpr( sizeof( T ) == 4 )
+   {
+      return std::is_signed< T >::value ? Kind::I32 : Kind::U32;
+   }
+   else if constexpr( sizeof( T ) == 8 )
+   {
+      return std::is_signed< T >::value ? Kind::I64 : Kind::U64;
+   }
+   else
+   {
+      return Kind::None;
+   }
+}
+
+template< class T >
+struct IsSupported : std::integral_constant< bool, KindOf< T >() != Kind::None >
+{
+};
+
+template< class T >
+struct IsLanewise : std::integral_constant< bool, KindOf< T >() == Kind::F32 || KindOf< T >() == Kind::F64 || KindOf< T >() == Kind::I32 || KindOf< T >() == Kind::U32 >
+{
+};
+
+// A Where() predicate that Filter() evaluates on lanes of T.
+template< class E, class T >
+struct IsFilter : std::integral_constant< bool, lanes::IsMask< E >::value && lanes::Fits< E, T >::value && IsLanewise< T >::value >
+{
+};
+
+// A Select() projection that Map() evaluates on lanes of T.
+template< class E, class T >
+struct IsMap : std::integral_constant< bool, lanes::IsExpr< E >::value && !lanes::IsMask< E >::value && lanes::Fits< E, T >::value && IsLanewise< T >::value >
+{
+};
+
+// A SelectWhere() selector that FilterMap() evaluates on lanes of T.
+template< class E, class T >
+struct IsFilterMap : std::false_type
+{
+};
+
+template< class C, class V, class T >
+struct IsFilterMap< lanes::When< C, V >, T > : std::integral_constant< bool, lanes::Fits< lanes::When< C, V >, T >::value && IsLanewise< T >::value >
+{
+};
+
+// Integer sums wrap around instead of overflowing.
+template< class T >
+T Plus( T a, T b )
+{
+   if constexpr( std::is_integral< T >::value )
+   {
+      using U = std::make_unsigned_t< T >;
+      return static_cast< T >( static_cast< U >( a ) + static_cast< U >( b ) );
+   }
+   else
+   {
+      return a + b;
+   }
+}
+
+template< class T >
+T Fold( T* lanes, const T* tail, size_t n )
+{
+   for( size_t half = Lanes / 2; half != 0; half /= 2 )
+   {
+      for( size_t k = 0; k < half; ++k )
+      {
+         lanes[ k ] = Plus( lanes[ k ], lanes[ k + half ] );
+      }
+   }
+   auto ret = lanes[ 0 ];
+   for( size_t i = 0; i < n; ++i )
+   {
+      ret = Plus( ret, tail[ i ] );
+   }
+   return ret;
+}
+
+// The first element that no other one beats, the same rule MinOrNone() and MaxOrNone() use; NaN included.
+template< bool Max, class T >
+size_t ExtremeScalar( const T* p, size_t n )
+{
+   size_t ret = 0;
+   for( size_t i = 1; i < n; ++i )
+   {
+      if( Max ? p[ ret ] < p[ i ] : p[ ret ] > p[ i ] )
+      {
+         ret = i;
+      }
+   }
+   return ret;
+}
+
+// Bit i of the result is set when p[ i ] is one of the k bytes of set.
+inline uint64_t MatchBytesScalar( const char* p, size_t n, const char* set, size_t k )
+{
+   uint64_t ret = 0;
+   for( size_t i = 0; i < n; ++i )
+   {
+      for( size_t j = 0; j < k; ++j )
+      {
+         if( p[ i ] == set[ j ] )
+         {
+            ret |= uint64_t{ 1 } << i;
+            break;
+         }
+      }
+   }
+   return ret;
+}
+
+// bits must not be zero.
+inline size_t LowestBit( uint64_t bits )
+{
+#if defined( _MSC_VER ) && !defined( __clang__ )
+   unsigned long ret;
+   _BitScanForward64( &ret, bits );
+   return ret;
+#else
+   return static_cast< size_t >( __builtin_ctzll( bits ) );
+#endif
+}
+
+namespace scalar
+{
+struct ByteOps
+{
+   static constexpr size_t Width = 1;
+};
+
+template< class T >
+struct Ops
+{
+   using V = T;
+
+   static constexpr size_t Width = 1;
+   static constexpr bool MinMax = false;
+   static constexpr bool Lanewise = false;
+
+   static V Load( const T* p )
+   {
+      return *p;
+   }
+
+   static void Store( T* p, V v )
+   {
+      *p = v;
+   }
+
+   static V Zero()
+   {
+      return T{};
+   }
+
+   static V Add( V a, V b )
+   {
+      return Plus( a, b );
+   }
+};
+
+#include "simd_kernels.h"
+} // namespace scalar
+
+#if defined( LINQCPP_SIMD_SSE2 )
+namespace sse2
+{
+struct ByteOps
+{
+   using V = __m128i;
+
+   static constexpr size_t Width = 16;
+
+   static V Load( const char* p )
+   {
+      return _mm_loadu_si128( reinterpret_cast< const __m128i* >( p ) );
+   }
+
+   static V Set1( char v )
+   {
+      return _mm_set1_epi8( v );
+   }
+
+   static V Equal( V a, V b )
+   {
+      return _mm_cmpeq_epi8( a, b );
+   }
+
+   static V Or( V a, V b )
+   {
+      return _mm_or_si128( a, b );
+   }
+
+   static uint32_t Mask( V a )
+   {
+      return static_cast< uint32_t >( _mm_movemask_epi8( a ) );
+   }
+};
+
+template< class T, Kind K = KindOf< T >() >
+struct Ops;
+
+template< class T >
+struct Ops< T, Kind::F32 >
+{
+   using V = __m128;
+
+   static constexpr size_t Width = 4;
+   static constexpr bool MinMax = true;
+   static constexpr bool Floating = true;
+   static constexpr bool Lanewise = true;
+
+   static V Load( const T* p )
+   {
+      return _mm_loadu_ps( p );
+   }
+
+   static void Store( T* p, V v )
+   {
+      _mm_storeu_ps( p, v );
+   }
+
+   static V Zero()
+   {
+      return _mm_setzero_ps();
+   }
+
+   static V Set1( T v )
+   {
+      return _mm_set1_ps( v );
+   }
+
+   static V Add( V a, V b )
+   {
+      return _mm_add_ps( a, b );
+   }
+
+   static V Min( V a, V b )
+   {
+      return _mm_min_ps( a, b );
+   }
+
+   static V Max( V a, V b )
+   {
+      return _mm_max_ps( a, b );
+   }
+
+   static int Eq( V a, V b )
+   {
+      return _mm_movemask_ps( _mm_cmpeq_ps( a, b ) );
+   }
+
+   static V Unordered( V a )
+   {
+      return _mm_cmpunord_ps( a, a );
+   }
+
+   static V Or( V a, V b )
+   {
+      return _mm_or_ps( a, b );
+   }
+
+   static int Mask( V a )
+   {
+      return _mm_movemask_ps( a );
+   }
+
+   static V Sub( V a, V b )
+   {
+      return _mm_sub_ps( a, b );
+   }
+
+   static V Mul( V a, V b )
+   {
+      return _mm_mul_ps( a, b );
+   }
+
+   static V Less( V a, V b )
+   {
+      return _mm_cmplt_ps( a, b );
+   }
+
+   static V LessEqual( V a, V b )
+   {
+      return _mm_cmple_ps( a, b );
+   }
+
+   static V Greater( V a, V b )
+   {
+      return _mm_cmpgt_ps( a, b );
+   }
+
+   static V GreaterEqual( V a, V b )
+   {
+      return _mm_cmpge_ps( a, b );
+   }
+
+   static V Equal( V a, V b )
+   {
+      return _mm_cmpeq_ps( a, b );
+   }
+
+   static V NotEqual( V a, V b )
+   {
+      return _mm_cmpneq_ps( a, b );
+   }
+
+   static V And( V a, V b )
+   {
+      return _mm_and_ps( a, b );
+   }
+};
+
+template< class T >
+struct Ops< T, Kind::F64 >
+{
+   using V = __m128d;
+
+   static constexpr size_t Width = 2;
+   static constexpr bool MinMax = true;
+   static constexpr bool Floating = true;
+   static constexpr bool Lanewise = true;
+
+   static V Load( const T* p )
+   {
+      return _mm_loadu_pd( p );
+   }
+
+   static void Store( T* p, V v )
+   {
+      _mm_storeu_pd( p, v );
+   }
+
+   static V Zero()
+   {
+      return _mm_setzero_pd();
+   }
+
+   static V Set1( T v )
+   {
+      return _mm_set1_pd( v );
+   }
+
+   static V Add( V a, V b )
+   {
+      return _mm_add_pd( a, b );
+   }
+
+   static V Min( V a, V b )
+   {
+      return _mm_min_pd( a, b );
+   }
+
+   static V Max( V a, V b )
+   {
+      return _mm_max_pd( a, b );
+   }
+
+   static int Eq( V a, V b )
+   {
+      return _mm_movemask_pd( _mm_cmpeq_pd( a, b ) );
+   }
+
+   static V Unordered( V a )
+   {
+      return _mm_cmpunord_pd( a, a );
+   }
+
+   static V Or( V a, V b )
+   {
+      return _mm_or_pd( a, b );
+   }
+
+   static int Mask( V a )
+   {
+      return _mm_movemask_pd( a );
+   }
+
+   static V Sub( V a, V b )
+   {
+      return _mm_sub_pd( a, b );
+   }
+
+   static V Mul( V a, V b )
+   {
+      return _mm_mul_pd( a, b );
+   }
+
+   static V Less( V a, V b )
+   {
+      return _mm_cmplt_pd( a, b );
+   }
+
+   static V LessEqual( V a, V b )
+   {
+      return _mm_cmple_pd( a, b );
+   }
+
+   static V Greater( V a, V b )
+   {
+      return _mm_cmpgt_pd( a, b );
+   }
+
+   static V GreaterEqual( V a, V b )
+   {
+      return _mm_cmpge_pd( a, b );
+   }
+
+   static V Equal( V a, V b )
+   {
+      return _mm_cmpeq_pd( a, b );
+   }
+
+   static V NotEqual( V a, V b )
+   {
+      return _mm_cmpneq_pd( a, b );
+   }
+
+   static V And( V a, V b )
+   {
+      return _mm_and_pd( a, b );
+   }
+};
+
+template< class T >
+struct IntOps
+{
+   using V = __m128i;
+
+   static constexpr bool Floating = false;
+
+   static V Load( const T* p )
+   {
+      return _mm_loadu_si128( reinterpret_cast< const __m128i* >( p ) );
+   }
+
+   static void Store( T* p, V v )
+   {
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( p ), v );
+   }
+
+   static V Zero()
+   {
+      return _mm_setzero_si128();
+   }
+};
+
+// SSE2 has no unsigned comparison, so unsigned operands are compared with their sign bits flipped.
+template< class T, Kind K >
+struct Int32Ops : IntOps< T >
+{
+   using V = __m128i;
+
+   static constexpr size_t Width = 4;
+   static constexpr bool MinMax = true;
+   static constexpr bool Lanewise = true;
+
+   static V Set1( T v )
+   {
+      return _mm_set1_epi32( static_cast< int >( v ) );
+   }
+
+   static V Add( V a, V b )
+   {
+      return _mm_add_epi32( a, b );
+   }
+
+   static V Greater( V a, V b )
+   {
+      if constexpr( K == Kind::U32 )
+      {
+         auto sign = _mm_set1_epi32( static_cast< int >( 0x80000000u ) );
+         return _mm_cmpgt_epi32( _mm_xor_si128( a, sign ), _mm_xor_si128( b, sign ) );
+      }
+      else
+      {
+         return _mm_cmpgt_epi32( a, b );
+      }
+   }
+
+   static V Min( V a, V b )
+   {
+      auto m = Greater( a, b );
+      return _mm_or_si128( _mm_and_si128( m, b ), _mm_andnot_si128( m, a ) );
+   }
+
+   static V Max( V a, V b )
+   {
+      auto m = Greater( a, b );
+      return _mm_or_si128( _mm_and_si128( m, a ), _mm_andnot_si128( m, b ) );
+   }
+
+   static int Eq( V a, V b )
+   {
+      return _mm_movemask_epi8( _mm_cmpeq_epi32( a, b ) );
+   }
+
+   static V Sub( V a, V b )
+   {
+      return _mm_sub_epi32( a, b );
+   }
+
+   static V Mul( V a, V b )
+   {
+      return Mul32( a, b );
+   }
+
+   static V Less( V a, V b )
+   {
+      return Greater( b, a );
+   }
+
+   static V LessEqual( V a, V b )
+   {
+      return _mm_xor_si128( Greater( a, b ), _mm_set1_epi32( -1 ) );
+   }
+
+   static V GreaterEqual( V a, V b )
+   {
+      return _mm_xor_si128( Greater( b, a ), _mm_set1_epi32( -1 ) );
+   }
+
+   static V Equal( V a, V b )
+   {
+      return _mm_cmpeq_epi32( a, b );
+   }
+
+   static V NotEqual( V a, V b )
+   {
+      return _mm_xor_si128( _mm_cmpeq_epi32( a, b ), _mm_set1_epi32( -1 ) );
+   }
+
+   static V And( V a, V b )
+   {
+      return _mm_and_si128( a, b );
+   }
+
+   static V Or( V a, V b )
+   {
+      return _mm_or_si128( a, b );
+   }
+
+   static int Mask( V a )
+   {
+      return _mm_movemask_ps( _mm_castsi128_ps( a ) );
+   }
+
+   // SSE2 has no 32 bit multiplication (SSE4.1), so the low halves of two 64 bit products are interleaved.
+   static V Mul32( V a, V b )
+   {
+      auto even = _mm_mul_epu32( a, b );
+      auto odd = _mm_mul_epu32( _mm_srli_si128( a, 4 ), _mm_srli_si128( b, 4 ) );
+      return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+   }
+};
+
+// Without a 64 bit comparison (SSE4.2), MinOrNone() and MaxOrNone() of 64 bit integers stay scalar.
+template< class T >
+struct Int64Ops : IntOps< T >
+{
+   using V = __m128i;
+
+   static constexpr size_t Width = 2;
+   static constexpr bool MinMax = false;
+   static constexpr bool Lanewise = false;
+
+   static V Set1( T v )
+   {
+      return _mm_set1_epi64x( static_cast< long long >( v ) );
+   }
+
+   static V Add( V a, V b )
+   {
+      return _mm_add_epi64( a, b );
+   }
+
+   static int Eq( V a, V b )
+   {
+      auto eq = _mm_cmpeq_epi32( a, b );
+      return _mm_movemask_epi8( _mm_and_si128( eq, _mm_shuffle_epi32( eq, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ) );
+   }
+};
+
+template< class T >
+struct Ops< T, Kind::I32 > : Int32Ops< T, Kind::I32 >
+{
+};
+
+template< class T >
+struct Ops< T, Kind::U32 > : Int32Ops< T, Kind::U32 >
+{
+};
+
+template< class T >
+struct Ops< T, Kind::I64 > : Int64Ops< T >
+{
+};
+
+template< class T >
+struct Ops< T, Kind::U64 > : Int64Ops< T >
+{
+};
+
+#include "simd_kernels.h"
+} // namespace sse2
+#endif
+
+#if defined( LINQCPP_SIMD_AVX2 )
+// Permutations that move the selected lanes of a mask to the front, for 32 bit lanes and for pairs of them.
+struct CompressTable
+{
+   alignas( 32 ) uint32_t mIndex32[ 256 ][ 8 ];
+   alignas( 32 ) uint32_t mIndex64[ 16 ][ 8 ];
+};
+
+constexpr CompressTable MakeCompressTable()
+{
+   CompressTable ret{};
+   for( uint32_t mask = 0; mask < 256; ++mask )
+   {
+      uint32_t k = 0;
+      for( uint32_t lane = 0; lane < 8; ++lane )
+      {
+         if( mask & ( 1u << lane ) )
+         {
+            ret.mIndex32[ mask ][ k++ ] = lane;
+         }
+      }
+   }
+   for( uint32_t mask = 0; mask < 16; ++mask )
+   {
+      uint32_t k = 0;
+      for( uint32_t lane = 0; lane < 4; ++lane )
+      {
+         if( mask & ( 1u << lane ) )
+         {
+            ret.mIndex64[ mask ][ k++ ] = 2 * lane;
+            ret.mIndex64[ mask ][ k++ ] = 2 * lane + 1;
+         }
+      }
+   }
+   return ret;
+}
+
+inline constexpr CompressTable compressTable = MakeCompressTable();
+#endif
+
+#if defined( LINQCPP_SIMD_AVX2_DISPATCH )
+#if defined( __clang__ )
+#pragma clang attribute push( __attribute__( ( target( "avx2,popcnt" ) ) ), apply_to = function )
+#else
+#pragma GCC push_options
+#pragma GCC target( "avx2,popcnt" )
+#endif
+#endif
+
+#if defined( LINQCPP_SIMD_AVX2 )
+namespace avx2
+{
+inline size_t PopCount( int bits )
+{
+   return static_cast< size_t >( _mm_popcnt_u32( static_cast< unsigned >( bits ) ) );
+}
+
+struct ByteOps
+{
+   using V = __m256i;
+
+   static constexpr size_t Width = 32;
+
+   static V Load( const char* p )
+   {
+      return _mm256_loadu_si256( reinterpret_cast< const __m256i* >( p ) );
+   }
+
+   static V Set1( char v )
+   {
+      return _mm256_set1_epi8( v );
+   }
+
+   static V Equal( V a, V b )
+   {
+      return _mm256_cmpeq_epi8( a, b );
+   }
+
+   static V Or( V a, V b )
+   {
+      return _mm256_or_si256( a, b );
+   }
+
+   static uint32_t Mask( V a )
+   {
+      return static_cast< uint32_t >( _mm256_movemask_epi8( a ) );
+   }
+};
+
+template< class T, Kind K = KindOf< T >() >
+struct Ops;
+
+template< class T >
+struct Ops< T, Kind::F32 >
+{
+   using V = __m256;
+
+   static constexpr size_t Width = 8;
+   static constexpr bool MinMax = true;
+   static constexpr bool Floating = true;
+   static constexpr bool Lanewise = true;
+
+   static V Load( const T* p )
+   {
+      return _mm256_loadu_ps( p );
+   }
+
+   static void Store( T* p, V v )
+   {
+      _mm256_storeu_ps( p, v );
+   }
+
+   static V Zero()
+   {
+      return _mm256_setzero_ps();
+   }
+
+   static V Set1( T v )
+   {
+      return _mm256_set1_ps( v );
+   }
+
+   static V Add( V a, V b )
+   {
+      return _mm256_add_ps( a, b );
+   }
+
+   static V Min( V a, V b )
+   {
+      return _mm256_min_ps( a, b );
+   }
+
+   static V Max( V a, V b )
+   {
+      return _mm256_max_ps( a, b );
+   }
+
+   static int Eq( V a, V b )
+   {
+      return _mm256_movemask_ps( _mm256_cmp_ps( a, b, _CMP_EQ_OQ ) );
+   }
+
+   static V Unordered( V a )
+   {
+      return _mm256_cmp_ps( a, a, _CMP_UNORD_Q );
+   }
+
+   static V Or( V a, V b )
+   {
+      return _mm256_or_ps( a, b );
+   }
+
+   static int Mask( V a )
+   {
+      return _mm256_movemask_ps( a );
+   }
+
+   static V Sub( V a, V b )
+   {
+      return _mm256_sub_ps( a, b );
+   }
+
+   static V Mul( V a, V b )
+   {
+      return _mm256_mul_ps( a, b );
+   }
+
+   static V Less( V a, V b )
+   {
+      return _mm256_cmp_ps( a, b, _CMP_LT_OQ );
+   }
+
+   static V LessEqual( V a, V b )
+   {
+      return _mm256_cmp_ps( a, b, _CMP_LE_OQ );
+   }
+
+   static V Greater( V a, V b )
+   {
+      return _mm256_cmp_ps( a, b, _CMP_GT_OQ );
+   }
+
+   static V GreaterEqual( V a, V b )
+   {
+      return _mm256_cmp_ps( a, b, _CMP_GE_OQ );
+   }
+
+   static V Equal( V a, V b )
+   {
+      return _mm256_cmp_ps( a, b, _CMP_EQ_OQ );
+   }
+
+   static V NotEqual( V a, V b )
+   {
+      return _mm256_cmp_ps( a, b, _CMP_NEQ_UQ );
+   }
+
+   static V And( V a, V b )
+   {
+      return _mm256_and_ps( a, b );
+   }
+
+   static size_t CompressIndex( uint32_t* out, uint32_t base, int bits )
+   {
+      auto index = _mm256_load_si256( reinterpret_cast< const __m256i* >( compressTable.mIndex32[ bits ] ) );
+      _mm256_storeu_si256( reinterpret_cast< __m256i* >( out ), _mm256_add_epi32( index, _mm256_set1_epi32( static_cast< int >( base ) ) ) );
+      return PopCount( bits );
+   }
+
+   static size_t Compress( T* out, V v, int bits )
+   {
+      auto index = _mm256_load_si256( reinterpret_cast< const __m256i* >( compressTable.mIndex32[ bits ] ) );
+      _mm256_storeu_ps( out, _mm256_permutevar8x32_ps( v, index ) );
+      return PopCount( bits );
+   }
+};
+
+template< class T >
+struct Ops< T, Kind::F64 >
+{
+   using V = __m256d;
+
+   static constexpr size_t Width = 4;
+   static constexpr bool MinMax = true;
+   static constexpr bool Floating = true;
+   static constexpr bool Lanewise = true;
+
+   static V Load( const T* p )
+   {
+      return _mm256_loadu_pd( p );
+   }
+
+   static void Store( T* p, V v )
+   {
+      _mm256_storeu_pd( p, v );
+   }
+
+   static V Zero()
+   {
+      return _mm256_setzero_pd();
+   }
+
+   static V Set1( T v )
+   {
+      return _mm256_set1_pd( v );
+   }
+
+   static V Add( V a, V b )
+   {
+      return _mm256_add_pd( a, b );
+   }
+
+   static V Min( V a, V b )
+   {
+      return _mm256_min_pd( a, b );
+   }
+
+   static V Max( V a, V b )
+   {
+      return _mm256_max_pd( a, b );
+   }
+
+   static int Eq( V a, V b )
+   {
+      return _mm256_movemask_pd( _mm256_cmp_pd( a, b, _CMP_EQ_OQ ) );
+   }
+
+   static V Unordered( V a )
+   {
+      return _mm256_cmp_pd( a, a, _CMP_UNORD_Q );
+   }
+
+   static V Or( V a, V b )
+   {
+      return _mm256_or_pd( a, b );
+   }
+
+   static int Mask( V a )
+   {
+      return _mm256_movemask_pd( a );
+   }
+
+   static V Sub( V a, V b )
+   {
+      return _mm256_sub_pd( a, b );
+   }
+
+   static V Mul( V a, V b )
+   {
+      return _mm256_mul_pd( a, b );
+   }
+
+   static V Less( V a, V b )
+   {
+      return _mm256_cmp_pd( a, b, _CMP_LT_OQ );
+   }
+
+   static V LessEqual( V a, V b )
+   {
+      return _mm256_cmp_pd( a, b, _CMP_LE_OQ );
+   }
+
+   static V Greater( V a, V b )
+   {
+      return _mm256_cmp_pd( a, b, _CMP_GT_OQ );
+   }
+
+   static V GreaterEqual( V a, V b )
+   {
+      return _mm256_cmp_pd( a, b, _CMP_GE_OQ );
+   }
+
+   static V Equal( V a, V b )
+   {
+      return _mm256_cmp_pd( a, b, _CMP_EQ_OQ );
+   }
+
+   static V NotEqual( V a, V b )
+   {
+      return _mm256_cmp_pd( a, b, _CMP_NEQ_UQ );
+   }
+
+   static V And( V a, V b )
+   {
+      return _mm256_and_pd( a, b );
+   }
+
+   static size_t CompressIndex( uint32_t* out, uint32_t base, int bits )
+   {
+      auto index = _mm_load_si128( reinterpret_cast< const __m128i* >( compressTable.mIndex32[ bits ] ) );
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( out ), _mm_add_epi32( index, _mm_set1_epi32( static_cast< int >( base ) ) ) );
+      return PopCount( bits );
+   }
+
+   static size_t Compress( T* out, V v, int bits )
+   {
+      auto index = _mm256_load_si256( reinterpret_cast< const __m256i* >( compressTable.mIndex64[ bits ] ) );
+      _mm256_storeu_pd( out, _mm256_castsi256_pd( _mm256_permutevar8x32_epi32( _mm256_castpd_si256( v ), index ) ) );
+      return PopCount( bits );
+   }
+};
+
+template< class T >
+struct IntOps
+{
+   using V = __m256i;
+
+   static constexpr bool MinMax = true;
+   static constexpr bool Floating = false;
+
+   static V Load( const T* p )
+   {
+      return _mm256_loadu_si256( reinterpret_cast< const __m256i* >( p ) );
+   }
+
+   static void Store( T* p, V v )
+   {
+      _mm256_storeu_si256( reinterpret_cast< __m256i* >( p ), v );
+   }
+
+   static V Zero()
+   {
+      return _mm256_setzero_si256();
+   }
+};
+
+template< class T, Kind K >
+struct Int32Ops : IntOps< T >
+{
+   using V = __m256i;
+
+   static constexpr size_t Width = 8;
+   static constexpr bool Lanewise = true;
+
+   static V Set1( T v )
+   {
+      return _mm256_set1_epi32( static_cast< int >( v ) );
+   }
+
+   static V Add( V a, V b )
+   {
+      return _mm256_add_epi32( a, b );
+   }
+
+   static V Min( V a, V b )
+   {
+      return K == Kind::U32 ? _mm256_min_epu32( a, b ) : _mm256_min_epi32( a, b );
+   }
+
+   static V Max( V a, V b )
+   {
+      return K == Kind::U32 ? _mm256_max_epu32( a, b ) : _mm256_max_epi32( a, b );
+   }
+
+   static int Eq( V a, V b )
+   {
+      return _mm256_movemask_epi8( _mm256_cmpeq_epi32( a, b ) );
+   }
+
+   static V Sub( V a, V b )
+   {
+      return _mm256_sub_epi32( a, b );
+   }
+
+   static V Mul( V a, V b )
+   {
+      return _mm256_mullo_epi32( a, b );
+   }
+
+   static V Greater( V a, V b )
+   {
+      if constexpr( K == Kind::U32 )
+      {
+         auto sign = _mm256_set1_epi32( static_cast< int >( 0x80000000u ) );
+         return _mm256_cmpgt_epi32( _mm256_xor_si256( a, sign ), _mm256_xor_si256( b, sign ) );
+      }
+      else
+      {
+         return _mm256_cmpgt_epi32( a, b );
+      }
+   }
+
+   static V Less( V a, V b )
+   {
+      return Greater( b, a );
+   }
+
+   static V LessEqual( V a, V b )
+   {
+      return _mm256_xor_si256( Greater( a, b ), _mm256_set1_epi32( -1 ) );
+   }
+
+   static V GreaterEqual( V a, V b )
+   {
+      return _mm256_xor_si256( Greater( b, a ), _mm256_set1_epi32( -1 ) );
+   }
+
+   static V Equal( V a, V b )
+   {
+      return _mm256_cmpeq_epi32( a, b );
+   }
+
+   static V NotEqual( V a, V b )
+   {
+      return _mm256_xor_si256( _mm256_cmpeq_epi32( a, b ), _mm256_set1_epi32( -1 ) );
+   }
+
+   static V And( V a, V b )
+   {
+      return _mm256_and_si256( a, b );
+   }
+
+   static V Or( V a, V b )
+   {
+      return _mm256_or_si256( a, b );
+   }
+
+   static int Mask( V a )
+   {
+      return _mm256_movemask_ps( _mm256_castsi256_ps( a ) );
+   }
+
+   static size_t CompressIndex( uint32_t* out, uint32_t base, int bits )
+   {
+      auto index = _mm256_load_si256( reinterpret_cast< const __m256i* >( compressTable.mIndex32[ bits ] ) );
+      _mm256_storeu_si256( reinterpret_cast< __m256i* >( out ), _mm256_add_epi32( index, _mm256_set1_epi32( static_cast< int >( base ) ) ) );
+      return PopCount( bits );
+   }
+
+   static size_t Compress( T* out, V v, int bits )
+   {
+      auto index = _mm256_load_si256( reinterpret_cast< const __m256i* >( compressTable.mIndex32[ bits ] ) );
+      _mm256_storeu_si256( reinterpret_cast< __m256i* >( out ), _mm256_permutevar8x32_epi32( v, index ) );
+      return PopCount( bits );
+   }
+};
+
+template< class T >
+struct Ops< T, Kind::I32 > : Int32Ops< T, Kind::I32 >
+{
+};
+
+template< class T >
+struct Ops< T, Kind::U32 > : Int32Ops< T, Kind::U32 >
+{
+};
+
+// AVX2 compares 64 bit integers as signed only, so unsigned operands are compared with their sign bits flipped.
+template< class T, Kind K >
+struct Int64Ops : IntOps< T >
+{
+   using V = __m256i;
+
+   static constexpr size_t Width = 4;
+   static constexpr bool Lanewise = false;
+
+   static V Set1( T v )
+   {
+      return _mm256_set1_epi64x( static_cast< long long >( v ) );
+   }
+
+   static V Add( V a, V b )
+   {
+      return _mm256_add_epi64( a, b );
+   }
+
+   static V Greater( V a, V b )
+   {
+      if constexpr( K == Kind::U64 )
+      {
+         auto sign = _mm256_set1_epi64x( static_cast< long long >( 0x8000000000000000ull ) );
+         return _mm256_cmpgt_epi64( _mm256_xor_si256( a, sign ), _mm256_xor_si256( b, sign ) );
+      }
+      else
+      {
+         return _mm256_cmpgt_epi64( a, b );
+      }
+   }
+
+   static V Min( V a, V b )
+   {
+      return _mm256_blendv_epi8( a, b, Greater( a, b ) );
+   }
+
+   static V Max( V a, V b )
+   {
+      return _mm256_blendv_epi8( b, a, Greater( a, b ) );
+   }
+
+   static int Eq( V a, V b )
+   {
+      return _mm256_movemask_epi8( _mm256_cmpeq_epi64( a, b ) );
+   }
+};
+
+template< class T >
+struct Ops< T, Kind::I64 > : Int64Ops< T, Kind::I64 >
+{
+};
+
+template< class T >
+struct Ops< T, Kind::U64 > : Int64Ops< T, Kind::U64 >
+{
+};
+
+#include "simd_kernels.h"
+} // namespace avx2
+#endif
+
+#if defined( LINQCPP_SIMD_AVX2_DISPATCH )
+#if defined( __clang__ )
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+inline bool HasAvx2()
+{
+#if defined( LINQCPP_SIMD_AVX2_DISPATCH )
+   static const bool ret = __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "popcnt" );
+   return ret;
+#elif defined( LINQCPP_SIMD_AVX2 )
+   return true;
+#else
+   return false;
+#endif
+}
+
+#if defined( LINQCPP_SIMD_AVX2 )
+#define LINQCPP_SIMD_CALL( f, ... ) ( HasAvx2() ? avx2::f( __VA_ARGS__ ) : sse2::f( __VA_ARGS__ ) )
+#elif defined( LINQCPP_SIMD_SSE2 )
+#define LINQCPP_SIMD_CALL( f, ... ) sse2::f( __VA_ARGS__ )
+#else
+#define LINQCPP_SIMD_CALL( f, ... ) scalar::f( __VA_ARGS__ )
+#endif
+
+template< class T >
+T Sum( const T* p, size_t n )
+{
+   return LINQCPP_SIMD_CALL( Sum, p, n );
+}
+
+// Index of the first occurrence of v, or n.
+template< class T >
+size_t Find( const T* p, size_t n, const T& v )
+{
+   return LINQCPP_SIMD_CALL( Find, p, n, v );
+}
+
+// n must not be zero.
+template< class T >
+size_t MinIndex( const T* p, size_t n )
+{
+   return LINQCPP_SIMD_CALL( Extreme< false >, p, n );
+}
+
+// n must not be zero.
+template< class T >
+size_t MaxIndex( const T* p, size_t n )
+{
+   return LINQCPP_SIMD_CALL( Extreme< true >, p, n );
+}
+
+// Writes the indices of the elements satisfying the predicate to out, which has room for n of them; returns their number.
+template< class T, class E >
+size_t Filter( const T* p, size_t n, const E& e, uint32_t* out )
+{
+   return LINQCPP_SIMD_CALL( Filter, p, n, e, out );
+}
+
+template< class T, class E >
+void Map( const T* p, size_t n, const E& e, T* out )
+{
+   LINQCPP_SIMD_CALL( Map, p, n, e, out );
+}
+
+// Writes the selected values to out, which has room for n of them; returns their number.
+template< class T, class C, class V >
+size_t FilterMap( const T* p, size_t n, const lanes::When< C, V >& e, T* out )
+{
+   return LINQCPP_SIMD_CALL( FilterMap, p, n, e, out );
+}
+
+// Bit i of the result is set when p[ i ] is one of the k bytes of set; n is at most 64 and k not zero.
+inline uint64_t MatchBytes( const char* p, size_t n, const char* set, size_t k )
+{
+   return LINQCPP_SIMD_CALL( MatchBytes<>, p, n, set, k );
+}
+
+#undef LINQCPP_SIMD_CALL
+} // namespace simd
+} // namespace d
+} // namespace linq
@@ -0,0 +1,370 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// No include guard: simd.h includes this file once per instruction set, inside a namespace that defines Ops< T >.
+
+// Calls f( 0 ) ... f( R - 1 ) unrolled, so that the accumulators stay in registers.
+template< size_t... I, class F >
+void Unroll( std::index_sequence< I... >, F&& f )
+{
+   ( f( I ), ... );
+}
+
+template< size_t R, class F >
+void Unroll( F&& f )
+{
+   Unroll( std::make_index_sequence< R >(), f );
+}
+
+template< class T >
+T Sum( const T* p, size_t n )
+{
+   using O = Ops< T >;
+   constexpr size_t R = Lanes / O::Width;
+
+   typename O::V acc[ R ];
+   Unroll< R >( [ & ]( size_t r ) { acc[ r ] = O::Zero(); } );
+
+   size_t i = 0;
+   for( ; i + Lanes <= n; i += Lanes )
+   {
+      Unroll< R >( [ & ]( size_t r ) { acc[ r ] = O::Add( acc[ r ], O::Load( p + i + r * O::Width ) ); } );
+   }
+
+   T lanes[ Lanes ];
+   Unroll< R >( [ & ]( size_t r ) { O::Store( lanes + r * O::Width, acc[ r ] ); } );
+   return Fold( lanes, p + i, n - i );
+}
+
+template< class T >
+size_t Find( const T* p, size_t n, const T& v )
+{
+   using O = Ops< T >;
+
+   size_t i = 0;
+   if constexpr( O::Width > 1 )
+   {
+      auto x = O::Set1( v );
+      for( ; i + 2 * O::Width <= n; i += 2 * O::Width )
+      {
+         if( O::Eq( O::Load( p + i ), x ) | O::Eq( O::Load( p + i + O::Width ), x ) )
+         {
+            break;
+         }
+      }
+   }
+   for( ; i < n; ++i )
+   {
+      if( p[ i ] == v )
+      {
+         return i;
+      }
+   }
+   return n;
+}
+
+template< class O = ByteOps >
+uint64_t MatchBytes( const char* p, size_t n, const char* set, size_t k )
+{
+   uint64_t ret = 0;
+   size_t i = 0;
+   if constexpr( O::Width > 1 )
+   {
+      for( ; i + O::Width <= n; i += O::Width )
+      {
+         auto v = O::Load( p + i );
+         auto m = O::Equal( v, O::Set1( set[ 0 ] ) );
+         for( size_t j = 1; j < k; ++j )
+         {
+            m = O::Or( m, O::Equal( v, O::Set1( set[ j ] ) ) );
+         }
+         ret |= uint64_t{ O::Mask( m ) } << i;
+      }
+   }
+   if( i < n )
+   {
+      ret |= MatchBytesScalar( p + i, n - i, set, k ) << i;
+   }
+   return ret;
+}
+
+// Reduces chunk by chunk lane-wise and remembers the first chunk holding the extreme value, then finds its first
+// occurrence there. A NaN anywhere falls back to the scalar rule.
+template< bool Max, class T >
+size_t Extreme( const T* p, size_t n )
+{
+   using O = Ops< T >;
+
+   if constexpr( !O::MinMax )
+   {
+      return ExtremeScalar< Max >( p, n );
+   }
+   else
+   {
+      constexpr size_t R = Lanes / O::Width;
+      constexpr size_t Chunk = 4096;
+
+      if( n < Lanes )
+      {
+         return ExtremeScalar< Max >( p, n );
+      }
+
+      T m{};
+      size_t best = 0;
+      size_t bestSize = 0;
+      for( size_t c = 0; c < n; )
+      {
+         auto chunk = p + c;
+         auto size = n - c < Chunk + Lanes ? n - c : Chunk;
+
+         typename O::V acc[ R ];
+         typename O::V nan[ R ];
+         Unroll< R >( [ & ]( size_t r ) {
+            acc[ r ] = O::Load( chunk + r * O::Width );
+            if constexpr( O::Floating )
+            {
+               nan[ r ] = O::Unordered( acc[ r ] );
+            }
+         } );
+
+         // The last block overlaps the previous one instead of leaving a tail, which min and max don't mind.
+         for( size_t i = Lanes; i < size; i += Lanes )
+         {
+            auto q = i + Lanes <= size ? chunk + i : chunk + size - Lanes;
+            Unroll< R >( [ & ]( size_t r ) {
+               auto x = O::Load( q + r * O::Width );
+               acc[ r ] = Max ? O::Max( acc[ r ], x ) : O::Min( acc[ r ], x );
+               if constexpr( O::Floating )
+               {
+                  nan[ r ] = O::Or( nan[ r ], O::Unordered( x ) );
+               }
+            } );
+         }
+
+         if constexpr( O::Floating )
+         {
+            auto any = nan[ 0 ];
+            Unroll< R >( [ & ]( size_t r ) { any = O::Or( any, nan[ r ] ); } );
+            if( O::Mask( any ) )
+            {
+               return ExtremeScalar< Max >( p, n );
+            }
+         }
+
+         T lanes[ Lanes ];
+         Unroll< R >( [ & ]( size_t r ) { O::Store( lanes + r * O::Width, acc[ r ] ); } );
+         for( size_t k = 0; k < Lanes; ++k )
+         {
+            if( bestSize == 0 || ( Max ? m < lanes[ k ] : m > lanes[ k ] ) )
+            {
+               m = lanes[ k ];
+               best = c;
+               bestSize = size;
+            }
+         }
+         c += size;
+      }
+      return best + Find( p + best, bestSize, m );
+   }
+}
+
+template< class O >
+typename O::V Eval( const lanes::Arg&, typename O::V x )
+{
+   return x;
+}
+
+template< class O, class C >
+typename O::V Eval( const lanes::Const< C >& c, typename O::V )
+{
+   return O::Set1( c.mValue );
+}
+
+template< class O >
+typename O::V Apply( lanes::Plus, typename O::V a, typename O::V b )
+{
+   return O::Add( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::Minus, typename O::V a, typename O::V b )
+{
+   return O::Sub( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::Multiplies, typename O::V a, typename O::V b )
+{
+   return O::Mul( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::Less, typename O::V a, typename O::V b )
+{
+   return O::Less( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::LessEqual, typename O::V a, typename O::V b )
+{
+   return O::LessEqual( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::Greater, typename O::V a, typename O::V b )
+{
+   return O::Greater( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::GreaterEqual, typename O::V a, typename O::V b )
+{
+   return O::GreaterEqual( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::Equal, typename O::V a, typename O::V b )
+{
+   return O::Equal( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::NotEqual, typename O::V a, typename O::V b )
+{
+   return O::NotEqual( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::And, typename O::V a, typename O::V b )
+{
+   return O::And( a, b );
+}
+
+template< class O >
+typename O::V Apply( lanes::Or, typename O::V a, typename O::V b )
+{
+   return O::Or( a, b );
+}
+
+template< class O, class Op, class L, class R >
+typename O::V Eval( const lanes::Binary< Op, L, R >& e, typename O::V x )
+{
+   return Apply< O >( Op{}, Eval< O >( e.mLhs, x ), Eval< O >( e.mRhs, x ) );
+}
+
+// AVX2 moves the selected lanes with one permutation. Otherwise every lane is stored, advancing only past the selected ones,
+// so that no branch depends on the data.
+template< class O >
+size_t CompressIndex( uint32_t* out, uint32_t base, int bits )
+{
+   if constexpr( sizeof( typename O::V ) == 32 )
+   {
+      return O::CompressIndex( out, base, bits );
+   }
+   else
+   {
+      size_t ret = 0;
+      for( uint32_t k = 0; k < O::Width; ++k )
+      {
+         out[ ret ] = base + k;
+         ret += ( bits >> k ) & 1;
+      }
+      return ret;
+   }
+}
+
+template< class O, class T >
+size_t Compress( T* out, typename O::V v, int bits )
+{
+   if constexpr( sizeof( typename O::V ) == 32 )
+   {
+      return O::Compress( out, v, bits );
+   }
+   else
+   {
+      T lanes[ O::Width ];
+      O::Store( lanes, v );
+      size_t ret = 0;
+      for( size_t k = 0; k < O::Width; ++k )
+      {
+         out[ ret ] = lanes[ k ];
+         ret += ( bits >> k ) & 1;
+      }
+      return ret;
+   }
+}
+
+template< class T, class E >
+size_t Filter( const T* p, size_t n, const E& e, uint32_t* out )
+{
+   using O = Ops< T >;
+
+   size_t ret = 0;
+   size_t i = 0;
+   if constexpr( O::Lanewise )
+   {
+      for( ; i + O::Width <= n; i += O::Width )
+      {
+         ret += CompressIndex< O >( out + ret, static_cast< uint32_t >( i ), O::Mask( Eval< O >( e, O::Load( p + i ) ) ) );
+      }
+   }
+   for( ; i < n; ++i )
+   {
+      out[ ret ] = static_cast< uint32_t >( i );
+      ret += e( p[ i ] ) ? 1 : 0;
+   }
+   return ret;
+}
+
+template< class T, class E >
+void Map( const T* p, size_t n, const E& e, T* out )
+{
+   using O = Ops< T >;
+
+   size_t i = 0;
+   if constexpr( O::Lanewise )
+   {
+      for( ; i + O::Width <= n; i += O::Width )
+      {
+         O::Store( out + i, Eval< O >( e, O::Load( p + i ) ) );
+      }
+   }
+   for( ; i < n; ++i )
+   {
+      out[ i ] = static_cast< T >( e( p[ i ] ) );
+   }
+}
+
+template< class T, class C, class V >
+size_t FilterMap( const T* p, size_t n, const lanes::When< C, V >& e, T* out )
+{
+   using O = Ops< T >;
+
+   size_t ret = 0;
+   size_t i = 0;
+   if constexpr( O::Lanewise )
+   {
+      for( ; i + O::Width <= n; i += O::Width )
+      {
+         auto x = O::Load( p + i );
+         ret += Compress< O >( out + ret, Eval< O >( e.mValue, x ), O::Mask( Eval< O >( e.mCondition, x ) ) );
+      }
+   }
+   for( ; i < n; ++i )
+   {
+      out[ ret ] = static_cast< T >( e.mValue( p[ i ] ) );
+      ret += e.mCondition( p[ i ] ) ? 1 : 0;
+   }
+   return ret;
+}
@@ -0,0 +1,93 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace linq
+{
+namespace d
+{
+struct SizeHint
+{
+   static constexpr size_t Infinity = std::numeric_limits< size_t >::max();
+
+   // Reservation for an inexact hint is capped at about one page of elements; the container grows past it if needed.
+   static constexpr size_t PageSize = 4096;
+
+   size_t mLower;
+   size_t mUpper;
+   bool mExact;
+
+   static constexpr SizeHint Exact( size_t size )
+   {
+      return { size, size, true };
+   }
+
+   static constexpr SizeHint Unknown()
+   {
+      return { 0, Infinity, false };
+   }
+
+   // A capacity supplied by the user is a guess, not a bound.
+   static constexpr SizeHint Guess( size_t capacity )
+   {
+      return { capacity, Infinity, false };
+   }
+
+   constexpr SizeHint Filter() const
+   {
+      return { 0, mUpper, mUpper == 0 };
+   }
+
+   constexpr SizeHint Take( size_t count ) const
+   {
+      return { std::min( mLower, count ), std::min( mUpper, count ), mExact || mLower >= count };
+   }
+
+   constexpr SizeHint Skip( size_t count ) const
+   {
+      return { mLower > count ? mLower - count : 0,
+               mUpper == Infinity ? Infinity : ( mUpper > count ? mUpper - count : 0 ),
+               mExact || mUpper <= count };
+   }
+
+   constexpr SizeHint Throttle( size_t count ) const
+   {
+      return { count == 0 ? 0 : ( mLower + count - 1 ) / count,
+               count == 0 ? 0 : ( mUpper == Infinity ? Infinity : ( mUpper + count - 1 ) / count ),
+               mExact || count == 0 };
+   }
+
+   constexpr SizeHint operator+( const SizeHint& h ) const
+   {
+      return { Infinity - mLower < h.mLower ? Infinity : mLower + h.mLower,
+               Infinity - mUpper < h.mUpper ? Infinity : mUpper + h.mUpper,
+               mExact && h.mExact };
+   }
+
+   constexpr size_t Capacity( size_t elementSize = 1 ) const
+   {
+      if( mExact )
+      {
+         return mLower;
+      }
+      return std::max( mLower, std::min( mUpper, std::max< size_t >( 16, PageSize / ( elementSize == 0 ? 1 : elementSize ) ) ) );
+   }
+};
+} // namespace d
+} // namespace linq
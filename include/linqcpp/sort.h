@@ -0,0 +1,319 @@
+// https://github.com/DevUtilsNet/linqcpp
+// Copyright (C) 2021 Kapitonov Maxim
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+
+// The sorts behind ToOrderedVector() and ToStableOrderedVector(). Integer, floating point and string keys go through an
+// LSD radix sort; strings by their first eight bytes, with the ties sorted by comparison afterwards. Other keys and custom
+// comparators use std::sort or std::stable_sort. Large inputs are cut into one chunk per thread, the chunks are sorted on
+// the pool and merged pairwise, which keeps the result stable when the chunk sort is.
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace linq
+{
+namespace d
+{
+namespace sort
+{
+// Below this size radix sort doesn't pay for its passes.
+constexpr size_t RadixMin = 256;
+
+// No chunk of a parallel sort is shorter than this.
+constexpr size_t ParallelMinChunk = size_t{ 1 } << 14;
+
+struct Identity
+{
+   template< class X >
+   const X& operator()( const X& x ) const
+   {
+      return x;
+   }
+};
+
+template< size_t Size >
+using Unsigned = std::conditional_t< Size == 1, uint8_t, std::conditional_t< Size == 2, uint16_t, std::conditional_t< Size == 4, uint32_t, uint64_t > > >;
+
+// Maps a key to an unsigned integer with the same order. Exact is false when equal radix keys may still differ.
+template< class K, class = void >
+struct Radix
+{
+   static constexpr bool Supported = false;
+};
+
+template< class K >
+struct Radix< K, std::enable_if_t< std::is_integral< K >::value && !std::is_same< K, bool >::value > >
+{
+   static constexpr bool Supported = true;
+   static constexpr bool Exact = true;
+   using U = Unsigned< sizeof( K ) >;
+
+   static U Key( K k )
+   {
+      constexpr auto sign = std::is_signed< K >::value ? static_cast< U >( U{ 1 } << ( sizeof( U ) * 8 - 1 ) ) : U{ 0 };
+      return static_cast< U >( static_cast< U >( k ) ^ sign );
+   }
+};
+
+// Negative numbers have every bit flipped, the others only the sign bit. -0.0 maps to +0.0, they compare equal.
+template< class K >
+struct Radix< K, std::enable_if_t< std::is_floating_point< K >::value && ( sizeof( K ) == 4 || sizeof( K ) == 8 ) > >
+{
+   static constexpr bool Supported = true;
+   static constexpr bool Exact = true;
+   using U = Unsigned< sizeof( K ) >;
+
+   static U Key( K k )
+   {
+      constexpr auto sign = static_cast< U >( U{ 1 } << ( sizeof( U ) * 8 - 1 ) );
+      U u = 0;
+      if( k != 0 )
+      {
+         std::memcpy( &u, &k, sizeof( k ) );
+      }
+      return ( u & sign ) != 0 ? static_cast< U >( ~u ) : static_cast< U >( u | sign );
+   }
+};
+
+template<>
+struct Radix< std::string_view >
+{
+   static constexpr bool Supported = true;
+   static constexpr bool Exact = false;
+   using U = uint64_t;
+
+   // The first eight bytes, big endian; a shorter string is padded with zeros and so orders before its extensions.
+   static U Key( std::string_view k )
+   {
+      U u = 0;
+      for( size_t i = 0; i < sizeof( U ); ++i )
+      {
+         u = ( u << 8 ) | ( i < k.size() ? static_cast< unsigned char >( k[ i ] ) : 0u );
+      }
+      return u;
+   }
+};
+
+template< class Traits, class Allocator >
+struct Radix< std::basic_string< char, Traits, Allocator > > : Radix< std::string_view >
+{
+};
+
+// Sorts [p, p + n) by the unsigned key( item ), one byte per pass, using buffer as scratch space. A pass whose byte is
+// the same for every item is skipped.
+template< class T, class K >
+void RadixSort( T* p, T* buffer, size_t n, K&& key )
+{
+   using U = decltype( key( *p ) );
+   constexpr size_t Passes = sizeof( U );
+   if( n < 2 )
+   {
+      return;
+   }
+
+   size_t counts[ Passes ][ 256 ] = {};
+   for( size_t i = 0; i < n; ++i )
+   {
+      auto k = key( p[ i ] );
+      for( size_t pass = 0; pass < Passes; ++pass )
+      {
+         ++counts[ pass ][ ( k >> ( pass * 8 ) ) & 0xff ];
+      }
+   }
+
+   auto from = p;
+   auto to = buffer;
+   for( size_t pass = 0; pass < Passes; ++pass )
+   {
+      auto& count = counts[ pass ];
+      if( count[ ( key( from[ 0 ] ) >> ( pass * 8 ) ) & 0xff ] == n )
+      {
+         continue;
+      }
+      size_t offset = 0;
+      for( auto& c : count )
+      {
+         auto size = c;
+         c = offset;
+         offset += size;
+      }
+      for( size_t i = 0; i < n; ++i )
+      {
+         to[ count[ ( key( from[ i ] ) >> ( pass * 8 ) ) & 0xff ]++ ] = std::move( from[ i ] );
+      }
+      std::swap( from, to );
+   }
+   if( from != p )
+   {
+      std::move( from, from + n, p );
+   }
+}
+
+inline size_t Degree( size_t degree )
+{
+   return degree == 0 ? ThreadPool::Default().Size() : degree;
+}
+
+inline size_t Chunks( size_t n, size_t degree )
+{
+   return std::max< size_t >( std::min( Degree( degree ), n / ParallelMinChunk ), 1 );
+}
+
+// Moves the sorted ranges [a, b) and [b, end) into out, stable. Unlike std::merge over move iterators, it hands lvalues to
+// compare, as std::sort does.
+template< class T, class C >
+void Merge( T* a, T* b, T* end, T* out, C& compare )
+{
+   auto i = a;
+   auto j = b;
+   while( i != b && j != end )
+   {
+      *out++ = compare( *j, *i ) ? std::move( *j++ ) : std::move( *i++ );
+   }
+   std::move( j, end, std::move( i, b, out ) );
+}
+
+// Sorts v by sorting its chunks on the pool with sortChunk( begin, end, buffer ), then merging them pairwise.
+template< class T, class C, class S >
+void MergeSort( std::vector< T >& v, size_t degree, C&& compare, S&& sortChunk )
+{
+   auto n = v.size();
+   auto chunks = Chunks( n, degree );
+   std::vector< T > buffer( n );
+   auto begin = [ & ]( size_t chunk ) { return n * std::min( chunk, chunks ) / chunks; };
+
+   ThreadPool::Default().For( chunks, Degree( degree ), [ & ]( size_t chunk ) {
+      sortChunk( v.data() + begin( chunk ), v.data() + begin( chunk + 1 ), buffer.data() + begin( chunk ) );
+   } );
+
+   for( size_t width = 1; width < chunks; width *= 2 )
+   {
+      ThreadPool::Default().For( ( chunks + 2 * width - 1 ) / ( 2 * width ), Degree( degree ), [ & ]( size_t group ) {
+         auto lo = begin( 2 * width * group );
+         auto mid = begin( 2 * width * group + width );
+         auto hi = begin( 2 * width * group + 2 * width );
+         Merge( v.data() + lo, v.data() + mid, v.data() + hi, buffer.data() + lo, compare );
+      } );
+      v.swap( buffer );
+   }
+}
+
+// Sorts v with compare; in parallel when v is large and its elements can fill a scratch buffer.
+template< class T, class C >
+void CompareSort( std::vector< T >& v, bool stable, size_t degree, C&& compare )
+{
+   auto sortChunk = [ & ]( T* begin, T* end, T* ) {
+      if( stable )
+      {
+         std::stable_sort( begin, end, compare );
+      }
+      else
+      {
+         std::sort( begin, end, compare );
+      }
+   };
+
+   if constexpr( std::is_default_constructible< T >::value )
+   {
+      if( Chunks( v.size(), degree ) > 1 )
+      {
+         MergeSort( v, degree, compare, sortChunk );
+         return;
+      }
+   }
+   sortChunk( v.data(), v.data() + v.size(), nullptr );
+}
+
+template< class U >
+struct Keyed
+{
+   U mKey;
+   size_t mIndex;
+};
+
+// Sorts v by key( element ) ascending; stable whenever the key has a radix mapping.
+template< class T, class K >
+void Sort( std::vector< T >& v, bool stable, size_t degree, K&& key )
+{
+   using Key = std::decay_t< std::invoke_result_t< K&, const T& > >;
+   using R = Radix< Key >;
+   auto compare = [ & ]( const T& a, const T& b ) { return key( a ) < key( b ); };
+
+   if constexpr( R::Supported )
+   {
+      auto n = v.size();
+      if( n >= RadixMin )
+      {
+         if constexpr( std::is_same< std::decay_t< K >, Identity >::value && R::Exact )
+         {
+            auto byKey = []( T a, T b ) { return R::Key( a ) < R::Key( b ); };
+            MergeSort( v, degree, byKey, [ & ]( T* begin, T* end, T* buffer ) { RadixSort( begin, buffer, end - begin, []( T m ) { return R::Key( m ); } ); } );
+         }
+         else
+         {
+            // Sorts ( radix key, index ) pairs, then moves the elements into their places.
+            using U = typename R::U;
+            std::vector< Keyed< U > > keyed( n );
+            for( size_t i = 0; i < n; ++i )
+            {
+               keyed[ i ] = { R::Key( key( v[ i ] ) ), i };
+            }
+            auto byKey = [ & ]( const Keyed< U >& a, const Keyed< U >& b ) { return a.mKey < b.mKey; };
+            MergeSort( keyed, degree, byKey, [ & ]( Keyed< U >* begin, Keyed< U >* end, Keyed< U >* buffer ) {
+               RadixSort( begin, buffer, end - begin, []( const Keyed< U >& m ) { return m.mKey; } );
+            } );
+
+            if constexpr( !R::Exact )
+            {
+               auto byValue = [ & ]( const Keyed< U >& a, const Keyed< U >& b ) { return key( v[ a.mIndex ] ) < key( v[ b.mIndex ] ); };
+               for( size_t i = 0; i < n; )
+               {
+                  auto j = i + 1;
+                  while( j < n && keyed[ j ].mKey == keyed[ i ].mKey )
+                  {
+                     ++j;
+                  }
+                  if( j - i > 1 )
+                  {
+                     std::stable_sort( keyed.begin() + i, keyed.begin() + j, byValue );
+                  }
+                  i = j;
+               }
+            }
+
+            std::vector< T > ret;
+            ret.reserve( n );
+            for( auto& m : keyed )
+            {
+               ret.push_back( std::move( v[ m.mIndex ] ) );
+            }
+            v.swap( ret );
+         }
+         return;
+      }
+   }
+   CompareSort( v, stable, degree, compare );
+}
+} // namespace sort
+} // namespace d
+} // namespace linq
@@ -1,7 +1,25 @@
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <memory_resource>
+#include <numeric>
 #include <optional>
+#include <sstream>
 
+#include <linqcpp/any_enumerable.h>
+#include <linqcpp/enumerable.h>
+#include <linqcpp/file.h>
 #include <linqcpp/linqcpp.h>
 
+#if defined( __cpp_impl_coroutine )
+#include <future>
+
+#include <linqcpp/async.h>
+#include <linqcpp/generator.h>
+#endif
+
+#include <boost/optional.hpp>
+
 namespace linq
 {
 BOOST_AUTO_TEST_SUITE( linqcpp )
@@ -1025,6 +1043,48 @@ BOOST_AUTO_TEST_CASE( Capacity )
    BOOST_REQUIRE_EQUAL( copyCalled, expectedCopyCalled );
 }
 
+BOOST_AUTO_TEST_CASE( SizeHint )
+{
+   std::vector< int > vector( 100000 );
+   std::list< int > list( 10 );
+
+   {
+      auto hint = From( vector ).GetSizeHint();
+      BOOST_TEST_REQUIRE( ( hint.mExact && hint.mLower == 100000 ) );
+   }
+
+   {
+      auto container = From( vector ).Where( []( int m ) { return m != 0; } );
+      auto hint = container.GetSizeHint();
+      BOOST_TEST_REQUIRE( ( !hint.mExact && hint.mLower == 0 && hint.mUpper == 100000 ) );
+      BOOST_TEST_REQUIRE( container.GetCapacity() < 100000 );
+      BOOST_TEST_REQUIRE( container.ToVector().capacity() == d::SizeHint::PageSize / sizeof( int ) );
+   }
+
+   {
+      auto hint = From( vector ).Concat( list ).Take( 50 ).GetSizeHint();
+      BOOST_TEST_REQUIRE( ( hint.mExact && hint.mLower == 50 ) );
+   }
+
+   {
+      auto hint = From( list ).Concat( From( vector ).Where( []( int ) { return true; } ) ).Skip( 5 ).GetSizeHint();
+      BOOST_TEST_REQUIRE( ( !hint.mExact && hint.mLower == 5 && hint.mUpper == 100005 ) );
+   }
+
+   {
+      auto container = From( list ).SelectMany< int >( [ & ]( int ) { return vector; } );
+      auto hint = container.GetSizeHint();
+      BOOST_TEST_REQUIRE( ( !hint.mExact && hint.mLower == 0 && hint.mUpper == d::SizeHint::Infinity ) );
+      BOOST_TEST_REQUIRE( container.GetCapacity() == d::SizeHint::PageSize / sizeof( int ) );
+      BOOST_TEST_REQUIRE( container.ToVector().size() == 1000000 );
+   }
+
+   {
+      auto hint = From( vector ).Throttle( 30000 ).GetSizeHint();
+      BOOST_TEST_REQUIRE( ( hint.mExact && hint.mLower == 4 ) );
+   }
+}
+
 BOOST_AUTO_TEST_CASE( Complex )
 {
    struct T1
@@ -1094,6 +1154,131 @@ BOOST_AUTO_TEST_CASE( Take )
    BOOST_REQUIRE_EQUAL( From( { 1, 2, 3, 4, 5 } ).Skip( 2 ).Take( 2 ).Sum(), 7 );
 }
 
+BOOST_AUTO_TEST_CASE( RandomAccess )
+{
+   {
+      std::vector< int > vector( 100 );
+      std::iota( vector.begin(), vector.end(), 0 );
+      auto calls = 0;
+      auto container = From( vector )
+                          .Select< int >( [ & ]( int m ) { ++calls; return m * 2; } )
+                          .Skip( 10 )
+                          .Take( 5 );
+      static_assert( d::IsRandomAccess< decltype( container.mShim ) >::value );
+      BOOST_TEST_REQUIRE( container.Count() == 5 );
+      BOOST_TEST_REQUIRE( container.Last() == 28 );
+      BOOST_TEST_REQUIRE( container.ElementAt( 1 ) == 22 );
+      BOOST_TEST_REQUIRE( !container.ElementAtOrNone( 5 ).is_initialized() );
+      BOOST_TEST_REQUIRE( calls == 2 );
+      BOOST_TEST_REQUIRE( ( container.ToVector() == std::vector< int >{ 20, 22, 24, 26, 28 } ) );
+      BOOST_TEST_REQUIRE( calls == 7 );
+      BOOST_TEST_REQUIRE( From( vector ).Skip( 200 ).Count() == 0 );
+      BOOST_TEST_REQUIRE( !From( vector ).Skip( 200 ).LastOrNone().is_initialized() );
+   }
+
+   {
+      std::list< int > list{ 1, 2, 3, 4 };
+      auto container = From( list ).Where( []( int m ) { return m != 2; } );
+      static_assert( !d::IsRandomAccess< decltype( container.mShim ) >::value );
+      BOOST_TEST_REQUIRE( container.ElementAt( 1 ) == 3 );
+      BOOST_TEST_REQUIRE( container.Skip( 1 ).Take( 1 ).Single() == 3 );
+      BOOST_CHECK_THROW( container.ElementAt( 3 ), std::out_of_range );
+      From( list ).Skip( 3 ).First() = 5;
+      BOOST_TEST_REQUIRE( list.back() == 5 );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( ForEach )
+{
+   {
+      std::vector< int > vector;
+      const std::vector< int > source{ 1, 2, 3, 4, 5, 6 };
+      auto container = From( source )
+                          .Where( []( int m ) { return m % 2 == 0; } )
+                          .Select< int >( []( int m ) { return m * 10; } );
+      auto iterator = container.mShim.CreateIterator();
+      BOOST_TEST_REQUIRE( !d::ForEach( iterator, [ & ]( int m ) { vector.push_back( m ); return vector.size() < 2; } ) );
+      BOOST_TEST_REQUIRE( iterator.Next().value() == 60 );
+      BOOST_TEST_REQUIRE( d::ForEach( iterator, d::NoneSink{} ) );
+      BOOST_TEST_REQUIRE( ( vector == std::vector< int >{ 20, 40 } ) );
+   }
+
+   {
+      std::vector< int > vector;
+      const std::vector< int > source{ 1, 2, 3 };
+      auto container = From( source )
+                          .SelectMany< int >( []( int m ) { return std::vector< int >( m, m ); } )
+                          .Concat( std::vector< int >{ 7 } );
+      auto iterator = container.mShim.CreateIterator();
+      BOOST_TEST_REQUIRE( iterator.Next().value() == 1 );
+      BOOST_TEST_REQUIRE( !d::ForEach( iterator, [ & ]( int m ) { vector.push_back( m ); return m != 3; } ) );
+      BOOST_TEST_REQUIRE( d::ForEach( iterator, [ & ]( int m ) { vector.push_back( m ); return true; } ) );
+      BOOST_TEST_REQUIRE( ( vector == std::vector< int >{ 2, 2, 3, 3, 3, 7 } ) );
+   }
+
+   {
+      std::vector< int > vector{ 1, 2, 3, 4 };
+      std::vector< int > vector2;
+      auto container = From( vector ).Until( []( int m ) { return m == 3; } );
+      BOOST_TEST_REQUIRE( container.Count() == 2 );
+      BOOST_TEST_REQUIRE( container.Aggregate( 0, []( int a, int m ) { return a + m; } ) == 3 );
+      BOOST_TEST_REQUIRE( container.Any( []( int m ) { return m == 2; } ) );
+      BOOST_TEST_REQUIRE( !container.Contains( 3 ) );
+      container.Select< int& >( []( int& m ) { return std::ref( m ); } ).StdEmplace( std::back_inserter( vector2 ) );
+      BOOST_TEST_REQUIRE( ( vector2 == std::vector< int >{ 1, 2 } ) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( NextBatch )
+{
+   {
+      std::vector< int > vector( 300 );
+      std::iota( vector.begin(), vector.end(), 0 );
+      auto iterator = From( vector ).mShim.CreateIterator();
+      d::Batch< int& > batch;
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == d::BatchSize );
+      BOOST_TEST_REQUIRE( batch.Data() == vector.data() );
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == d::BatchSize );
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == 300 - 2 * d::BatchSize );
+      BOOST_TEST_REQUIRE( batch[ 0 ] == 2 * d::BatchSize );
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == 0 );
+
+      BOOST_TEST_REQUIRE( From( vector ).Count() == 300 );
+      BOOST_TEST_REQUIRE( From( vector ).Sum() == 299 * 150 );
+      BOOST_TEST_REQUIRE( From( vector ).MinOrNone().value() == 0 );
+      BOOST_TEST_REQUIRE( From( vector ).MaxOrNone().value() == 299 );
+      BOOST_TEST_REQUIRE( ( From( vector ).ToVector() == vector ) );
+   }
+
+   {
+      std::list< std::string > list{ "1", "2", "3" };
+      auto container = From( list ).Select< std::string >( []( const std::string& m ) { return m + m; } );
+      auto iterator = container.mShim.CreateIterator();
+      d::Batch< std::string, 2 > batch;
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == 2 );
+      BOOST_TEST_REQUIRE( batch[ 1 ] == "22" );
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == 1 );
+      BOOST_TEST_REQUIRE( batch[ 0 ] == "33" );
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == 0 );
+
+      auto iterator2 = From( list ).mShim.CreateIterator();
+      d::Batch< std::string&, 2 > batch2;
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator2, batch2 ) == 2 );
+      BOOST_TEST_REQUIRE( batch2.Data() == nullptr );
+      BOOST_TEST_REQUIRE( &batch2[ 1 ] == &*std::next( list.begin() ) );
+   }
+
+   {
+      auto i = 0;
+      auto container = From( [ & ]() { return i < 5 ? boost::optional< int >{ i++ } : boost::none; }, 0 );
+      d::Batch< int, 4 > batch;
+      auto iterator = container.mShim.CreateIterator();
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == 4 );
+      BOOST_TEST_REQUIRE( d::NextBatch( iterator, batch ) == 1 );
+      BOOST_TEST_REQUIRE( batch[ 0 ] == 4 );
+   }
+}
+
 // BOOST_AUTO_TEST_CASE(LinqCppAsTearOffContainerTest)
 // {
 
@@ -1533,6 +1718,1014 @@ BOOST_AUTO_TEST_CASE( MinMax )
    }
 }
 
+BOOST_AUTO_TEST_CASE( Simd )
+{
+   static_assert( d::IsContiguous< decltype( From( std::vector< int >() ).mShim ) >::value );
+   static_assert( !d::IsContiguous< decltype( From( std::list< int >() ).mShim ) >::value );
+
+   for( size_t size : { 0, 1, 15, 16, 17, 31, 33, 100, 1000 } )
+   {
+      std::vector< int > ints( size );
+      std::vector< double > doubles( size );
+      std::vector< uint64_t > longs( size );
+      for( size_t i = 0; i < size; ++i )
+      {
+         ints[ i ] = static_cast< int >( ( i * 7919 ) % 101 ) - 50;
+         doubles[ i ] = ints[ i ] * 0.5;
+         longs[ i ] = ( i * 7919 ) % 101 + ( i % 2 ? 0x8000000000000000ull : 0 );
+      }
+      auto where = []( auto&& ) { return true; };
+
+      BOOST_TEST_REQUIRE( From( ints ).Sum() == From( ints ).Where( where ).Sum() );
+      BOOST_TEST_REQUIRE( From( doubles ).Sum() == From( doubles ).Where( where ).Sum() );
+      BOOST_TEST_REQUIRE( From( longs ).Sum() == From( longs ).Where( where ).Sum() );
+      BOOST_TEST_REQUIRE( From( ints ).SumOrNone().is_initialized() == ( size != 0 ) );
+      BOOST_TEST_REQUIRE( From( ints ).Contains( 7 ) == From( ints ).Where( where ).Contains( 7 ) );
+      BOOST_TEST_REQUIRE( From( doubles ).Contains( 3.5 ) == From( doubles ).Where( where ).Contains( 3.5 ) );
+      BOOST_TEST_REQUIRE( !From( longs ).Contains( uint64_t{ 1000 } ) );
+
+      if( size != 0 )
+      {
+         BOOST_TEST_REQUIRE( &From( ints ).MinOrNone< const int& >().value() == &From( ints ).Where( where ).MinOrNone< const int& >().value() );
+         BOOST_TEST_REQUIRE( &From( ints ).MaxOrNone< const int& >().value() == &From( ints ).Where( where ).MaxOrNone< const int& >().value() );
+         BOOST_TEST_REQUIRE( &From( doubles ).MinOrNone< const double& >().value() == &From( doubles ).Where( where ).MinOrNone< const double& >().value() );
+         BOOST_TEST_REQUIRE( From( longs ).Max() == From( longs ).Where( where ).Max() );
+         BOOST_TEST_REQUIRE( From( longs ).Min() == From( longs ).Where( where ).Min() );
+      }
+   }
+
+   {
+      std::vector< double > doubles( 40, 1.0 );
+      doubles[ 20 ] = std::numeric_limits< double >::quiet_NaN();
+      BOOST_TEST_REQUIRE( From( doubles ).Max() == 1.0 );
+      doubles[ 0 ] = std::numeric_limits< double >::quiet_NaN();
+      BOOST_TEST_REQUIRE( std::isnan( From( doubles ).Max() ) );
+   }
+
+   {
+      std::vector< double > doubles( 40, 0.0 );
+      doubles[ 30 ] = -0.0;
+      BOOST_TEST_REQUIRE( !std::signbit( From( doubles ).Min() ) );
+   }
+
+   {
+      float floats[] = { 0.1f, 0.2f, 0.3f };
+      BOOST_TEST_REQUIRE( From( floats ).Sum() == 0.1f + 0.2f + 0.3f );
+      BOOST_TEST_REQUIRE( From( floats ).Max() == 0.3f );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( Lanes )
+{
+   std::vector< int > ints( 300 );
+   std::vector< double > doubles( 300 );
+   for( size_t i = 0; i < ints.size(); ++i )
+   {
+      ints[ i ] = static_cast< int >( ( i * 7919 ) % 101 ) - 50;
+      doubles[ i ] = ints[ i ] * 0.5;
+   }
+
+   {
+      auto where = From( ints ).Where( arg > 0 && arg != 7 );
+      static_assert( d::IsBatchPreferred< decltype( where.mShim.CreateIterator() ) >::value );
+      std::vector< int > expected;
+      std::copy_if( ints.begin(), ints.end(), std::back_inserter( expected ), []( int m ) { return m > 0 && m != 7; } );
+      BOOST_TEST_REQUIRE( where.ToVector() == expected );
+      BOOST_TEST_REQUIRE( where.Count() == expected.size() );
+      BOOST_TEST_REQUIRE( where.Sum() == std::accumulate( expected.begin(), expected.end(), 0 ) );
+      BOOST_TEST_REQUIRE( &where.First() == &*std::find( ints.begin(), ints.end(), expected.front() ) );
+   }
+
+   {
+      auto select = From( ints ).Where( arg > 0 ).Select< int >( arg * 2 + 1 );
+      static_assert( d::IsBatchPreferred< decltype( select.mShim.CreateIterator() ) >::value );
+      BOOST_TEST_REQUIRE( select.ToVector() == From( ints ).Where( []( int m ) { return m > 0; } ).Select< int >( []( int m ) { return m * 2 + 1; } ).ToVector() );
+   }
+
+   {
+      auto selectWhere = From( doubles ).SelectWhere< double >( When( arg < 0.0, arg * arg ) );
+      static_assert( d::IsBatchPreferred< decltype( selectWhere.mShim.CreateIterator() ) >::value );
+      std::vector< double > expected;
+      for( auto m : doubles )
+      {
+         if( m < 0.0 )
+         {
+            expected.push_back( m * m );
+         }
+      }
+      BOOST_TEST_REQUIRE( selectWhere.ToVector() == expected );
+   }
+
+   {
+      auto scalar = From( doubles ).Where( arg > 0 );
+      static_assert( !d::IsBatchPreferred< decltype( scalar.mShim.CreateIterator() ) >::value );
+      BOOST_TEST_REQUIRE( scalar.Count() == From( doubles ).Where( arg > 0.0 ).Count() );
+
+      std::list< int > list( ints.begin(), ints.end() );
+      BOOST_TEST_REQUIRE( From( list ).Where( arg >= 10 ).ToVector() == From( ints ).Where( arg >= 10 ).ToVector() );
+      BOOST_TEST_REQUIRE( From( { 1, 2, 3 } ).Where( arg == 2 ).Single() == 2 );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( Parallel )
+{
+   std::vector< int > ints( 100000 );
+   for( size_t i = 0; i < ints.size(); ++i )
+   {
+      ints[ i ] = static_cast< int >( ( i * 7919 ) % 1001 ) - 500;
+   }
+   auto odd = []( int m ) { return m % 2 != 0; };
+   auto square = []( int m ) { return static_cast< long long >( m ) * m; };
+
+   {
+      auto parallel = From( ints ).AsOrderedParallel( 4 ).Where( odd ).Select< long long >( square );
+      static_assert( d::IsPartitioned< std::decay_t< decltype( parallel.mShim ) > >::value );
+      auto sequential = From( ints ).Where( odd ).Select< long long >( square );
+      BOOST_TEST_REQUIRE( parallel.ToVector() == sequential.ToVector() );
+      BOOST_TEST_REQUIRE( parallel.Count() == sequential.Count() );
+      BOOST_TEST_REQUIRE( parallel.Sum() == sequential.Sum() );
+      BOOST_TEST_REQUIRE( parallel.ToUnorderedSet() == sequential.ToUnorderedSet() );
+      BOOST_TEST_REQUIRE( parallel.Aggregate( 0LL, []( long long a, long long m ) { return std::max( a, m ); }, []( long long a, long long b ) { return std::max( a, b ); } ) == 249001 );
+      BOOST_TEST_REQUIRE( parallel.Any( []( long long m ) { return m == 249001; } ) );
+      BOOST_TEST_REQUIRE( !parallel.Any( []( long long m ) { return m == 4; } ) );
+      BOOST_TEST_REQUIRE( parallel.All( []( long long m ) { return m % 2 != 0; } ) );
+      BOOST_TEST_REQUIRE( parallel.First() == sequential.First() );
+   }
+
+   {
+      auto parallel = From( ints ).AsParallel().SelectWhere< int >( When( arg > 0, arg * 3 ) );
+      auto vector = parallel.ToVector();
+      std::sort( vector.begin(), vector.end() );
+      BOOST_TEST_REQUIRE( vector == From( ints ).SelectWhere< int >( When( arg > 0, arg * 3 ) ).ToOrderedVector() );
+      BOOST_TEST_REQUIRE( From( ints ).AsParallel( 3 ).Where( arg < 0 ).Count() == From( ints ).Where( arg < 0 ).Count() );
+      BOOST_TEST_REQUIRE( From( ints ).AsParallel().Sum() == From( ints ).Sum() );
+   }
+
+   {
+      std::vector< std::vector< int > > nested( 3000, { 1, 2, 3 } );
+      auto many = From( nested ).AsOrderedParallel( 2 ).SelectMany< int >( []( const std::vector< int >& m ) { return m; } );
+      BOOST_TEST_REQUIRE( many.Count() == 9000 );
+      BOOST_TEST_REQUIRE( many.ToVector() == From( nested ).SelectMany< int >( []( const std::vector< int >& m ) { return m; } ).ToVector() );
+      BOOST_TEST_REQUIRE( From( ints ).AsParallel().Distinct().Count() == 1001 );
+      BOOST_TEST_REQUIRE( !From( std::vector< int >{} ).AsParallel().Where( odd ).SumOrNone().is_initialized() );
+   }
+
+   {
+      auto throwing = From( ints ).AsParallel( 4 ).Where( []( int m ) {
+         if( m == 500 )
+         {
+            throw std::runtime_error( "500" );
+         }
+         return true;
+      } );
+      BOOST_CHECK_THROW( throwing.Count(), std::runtime_error );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( OrderedVector )
+{
+   std::vector< int > ints( 100000 );
+   std::vector< double > doubles( ints.size() );
+   for( size_t i = 0; i < ints.size(); ++i )
+   {
+      ints[ i ] = static_cast< int >( ( i * 2654435761u ) % 2000003 ) - 1000000;
+      doubles[ i ] = i % 1000 == 0 ? -0.0 : ints[ i ] / 7.0;
+   }
+
+   {
+      auto expected = ints;
+      std::sort( expected.begin(), expected.end() );
+      BOOST_TEST_REQUIRE( From( ints ).ToOrderedVector() == expected );
+      BOOST_TEST_REQUIRE( From( ints ).AsParallel( 4 ).ToStableOrderedVector() == expected );
+      BOOST_TEST_REQUIRE( From( ints ).Take( 100 ).ToOrderedVector() == From( ints ).Take( 100 ).ToOrderedVector( std::less<>() ) );
+
+      std::sort( expected.begin(), expected.end(), std::greater<>() );
+      BOOST_TEST_REQUIRE( From( ints ).AsParallel( 4 ).ToOrderedVector( std::greater<>() ) == expected );
+      BOOST_TEST_REQUIRE( From( ints ).ToOrderedVector( []( int m ) { return -static_cast< long long >( m ); } ) == expected );
+   }
+
+   {
+      auto expected = doubles;
+      std::stable_sort( expected.begin(), expected.end() );
+      auto sorted = From( doubles ).AsParallel( 4 ).ToStableOrderedVector();
+      BOOST_TEST_REQUIRE( sorted == expected );
+      BOOST_TEST_REQUIRE( std::equal( sorted.begin(), sorted.end(), expected.begin(), []( double a, double b ) { return std::signbit( a ) == std::signbit( b ); } ) );
+
+      std::vector< uint8_t > bytes( 1000 );
+      std::vector< int64_t > longs( 1000 );
+      for( size_t i = 0; i < bytes.size(); ++i )
+      {
+         bytes[ i ] = static_cast< uint8_t >( ints[ i ] );
+         longs[ i ] = static_cast< int64_t >( ints[ i ] ) << 30;
+      }
+      auto sortedBytes = From( bytes ).ToOrderedVector();
+      BOOST_TEST_REQUIRE( std::is_sorted( sortedBytes.begin(), sortedBytes.end() ) );
+      auto sortedLongs = From( longs ).ToOrderedVector();
+      BOOST_TEST_REQUIRE( std::is_sorted( sortedLongs.begin(), sortedLongs.end() ) );
+   }
+
+   {
+      struct Row
+      {
+         std::string mName;
+         size_t mIndex;
+      };
+      std::vector< Row > rows;
+      for( size_t i = 0; i < 5000; ++i )
+      {
+         rows.push_back( { "prefix__" + std::to_string( i % 37 ) + ( i % 2 ? "" : "!" ), i } );
+      }
+      auto expected = rows;
+      std::stable_sort( expected.begin(), expected.end(), []( const Row& a, const Row& b ) { return a.mName < b.mName; } );
+      auto sorted = From( rows ).ToStableOrderedVector( []( const Row& m ) -> const std::string& { return m.mName; } );
+      BOOST_TEST_REQUIRE( From( sorted ).Select< size_t >( []( const Row& m ) { return m.mIndex; } ).ToVector() ==
+                          From( expected ).Select< size_t >( []( const Row& m ) { return m.mIndex; } ).ToVector() );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( OrderBy )
+{
+   struct Row
+   {
+      int mAge;
+      std::string mName;
+   };
+   std::vector< Row > rows;
+   for( int i = 0; i < 10000; ++i )
+   {
+      rows.push_back( { ( i * 7919 ) % 97, std::to_string( ( i * 31 ) % 1000 ) } );
+   }
+   auto expected = rows;
+   std::stable_sort( expected.begin(), expected.end(), []( const Row& a, const Row& b ) { return a.mAge < b.mAge || ( a.mAge == b.mAge && a.mName > b.mName ); } );
+   auto names = []( const std::vector< Row >& m ) { return From( m ).Select< std::string >( []( const Row& r ) { return r.mName; } ).ToVector(); };
+
+   size_t calls = 0;
+   auto ordered = From( rows )
+                     .OrderBy( [ & ]( const Row& m ) {
+                        ++calls;
+                        return m.mAge;
+                     } )
+                     .ThenByDescending( []( const Row& m ) { return m.mName; } );
+   BOOST_TEST_REQUIRE( names( ordered.ToVector() ) == names( expected ) );
+   BOOST_TEST_REQUIRE( calls == rows.size() );
+
+   BOOST_TEST_REQUIRE( ordered.First().mName == expected.front().mName );
+   BOOST_TEST_REQUIRE( names( ordered.Take( 50 ).ToVector() ) == names( { expected.begin(), expected.begin() + 50 } ) );
+   BOOST_TEST_REQUIRE( names( ordered.Skip( 5000 ).Take( 10 ).ToVector() ) == names( { expected.begin() + 5000, expected.begin() + 5010 } ) );
+   BOOST_TEST_REQUIRE( ordered.Any( []( const Row& m ) { return m.mAge == 0; } ) );
+   BOOST_TEST_REQUIRE( ordered.Count() == rows.size() );
+
+   {
+      auto it = ordered.mShim.CreateIterator();
+      for( size_t i = 0; i < expected.size(); ++i )
+      {
+         BOOST_TEST_REQUIRE( it.Next().value().mName == expected[ i ].mName );
+      }
+      BOOST_TEST_REQUIRE( !it.Next().is_initialized() );
+   }
+
+   BOOST_TEST_REQUIRE( From( { 3, 1, 2 } ).OrderByDescending( []( int m ) { return m; } ).ToVector() == ( std::vector< int >{ 3, 2, 1 } ) );
+   BOOST_TEST_REQUIRE( From( { 3, 1, 2, 4 } ).OrderBy( []( int m ) { return m % 2; } ).ThenBy( []( int m ) { return m; } ).Where( arg > 1 ).ToVector() ==
+                       ( std::vector< int >{ 2, 4, 3 } ) );
+   BOOST_TEST_REQUIRE( !From( std::vector< int >{} ).OrderBy( []( int m ) { return m; } ).FirstOrNone().is_initialized() );
+}
+
+BOOST_AUTO_TEST_CASE( TopK )
+{
+   std::vector< int > ints( 100000 );
+   for( size_t i = 0; i < ints.size(); ++i )
+   {
+      ints[ i ] = static_cast< int >( ( i * 2654435761u ) % 1000003 );
+   }
+   auto sorted = ints;
+   std::sort( sorted.begin(), sorted.end() );
+
+   BOOST_TEST_REQUIRE( From( ints ).BottomK( 50 ) == std::vector< int >( sorted.begin(), sorted.begin() + 50 ) );
+   BOOST_TEST_REQUIRE( From( ints ).TopK( 50 ) == std::vector< int >( sorted.rbegin(), sorted.rbegin() + 50 ) );
+   BOOST_TEST_REQUIRE( From( ints ).AsParallel( 4 ).TopK( 50 ) == std::vector< int >( sorted.rbegin(), sorted.rbegin() + 50 ) );
+   BOOST_TEST_REQUIRE( From( ints ).AsParallel( 4 ).Where( arg > 500000 ).BottomK( 3 ) == From( sorted ).Where( arg > 500000 ).Take( 3 ).ToVector() );
+
+   auto byLastDigit = []( int& a, int& b ) { return a % 10 < b % 10; };
+   auto top = From( ints ).TopK( 10, byLastDigit );
+   BOOST_TEST_REQUIRE( From( top ).All( []( int m ) { return m % 10 == 9; } ) );
+
+   BOOST_TEST_REQUIRE( From( { 3, 1, 2 } ).TopK( 5 ) == ( std::vector< int >{ 3, 2, 1 } ) );
+   BOOST_TEST_REQUIRE( From( { 3, 1, 2 } ).BottomK( 0 ).empty() );
+   BOOST_TEST_REQUIRE( From( std::vector< std::string >{ "b", "c", "a" } ).BottomK( 2 ) == ( std::vector< std::string >{ "a", "b" } ) );
+}
+
+BOOST_AUTO_TEST_CASE( GroupBy )
+{
+   std::vector< int > ints( 10000 );
+   for( size_t i = 0; i < ints.size(); ++i )
+   {
+      ints[ i ] = static_cast< int >( ( i * 7919 ) % 1009 );
+   }
+
+   {
+      auto groups = From( ints ).GroupBy( []( int m ) { return m % 100; } ).ToVector();
+      BOOST_TEST_REQUIRE( groups.size() == 100 );
+      BOOST_TEST_REQUIRE( From( groups ).Aggregate( size_t{}, []( size_t a, const auto& m ) { return a + m.second.size(); } ) == ints.size() );
+      for( auto& group : groups )
+      {
+         BOOST_TEST_REQUIRE( From( group.second ).All( [ & ]( int m ) { return m % 100 == group.first; } ) );
+         BOOST_TEST_REQUIRE( group.second == From( ints ).Where( [ & ]( int m ) { return m % 100 == group.first; } ).ToVector() );
+      }
+   }
+
+   {
+      auto sums = From( ints ).GroupByAggregate( []( int m ) { return std::to_string( m % 7 ); }, 0LL, []( long long a, int m ) { return a + m; } );
+      auto counts = From( ints ).GroupByAggregate( []( int m ) { return m % 7; }, size_t{}, []( size_t& a, int ) { ++a; } );
+      BOOST_TEST_REQUIRE( sums.Count() == 7 );
+      BOOST_TEST_REQUIRE( From( counts ).Aggregate( size_t{}, []( size_t a, const auto& m ) { return a + m.second; } ) == ints.size() );
+      for( auto&& m : sums )
+      {
+         auto expected = From( ints ).Where( [ & ]( int v ) { return std::to_string( v % 7 ) == m.first; } ).Select< long long >( []( int v ) { return v; } ).Sum();
+         BOOST_TEST_REQUIRE( m.second == expected );
+      }
+   }
+
+   BOOST_TEST_REQUIRE( From( std::vector< int >{} ).GroupBy( []( int m ) { return m; } ).Count() == 0 );
+   BOOST_TEST_REQUIRE( From( { 1, 2, 1 } ).GroupBy( []( int m ) { return m; } ).Select< size_t >( []( const auto& m ) { return m.second.size(); } ).ToOrderedVector() ==
+                       ( std::vector< size_t >{ 1, 2 } ) );
+
+   d::FlatHashMap< int, int > map;
+   for( int i = 0; i < 1000; ++i )
+   {
+      BOOST_TEST_REQUIRE( map.TryEmplace( i * 1024, i ).second );
+   }
+   BOOST_TEST_REQUIRE( !map.TryEmplace( 1024, 0 ).second );
+   BOOST_TEST_REQUIRE( *map.Find( 999 * 1024 ) == 999 );
+   BOOST_TEST_REQUIRE( map.Find( 1 ) == nullptr );
+   BOOST_TEST_REQUIRE( map.Size() == 1000 );
+}
+
+BOOST_AUTO_TEST_CASE( Join )
+{
+   struct Event
+   {
+      int mUser;
+      int mValue;
+   };
+   struct User
+   {
+      int mId;
+      std::string mName;
+   };
+   std::vector< Event > events;
+   for( int i = 0; i < 10000; ++i )
+   {
+      events.push_back( { ( i * 7919 ) % 600, i } );
+   }
+   std::vector< User > users;
+   for( int i = 0; i < 500; ++i )
+   {
+      users.push_back( { i, "user" + std::to_string( i ) } );
+   }
+   users.push_back( { 7, "seven" } );
+
+   auto eventUser = []( const Event& m ) { return m.mUser; };
+   auto userId = []( const User& m ) { return m.mId; };
+   auto nested = From( events )
+                    .SelectMany< std::string >( [ & ]( const Event& e ) {
+                       return From( users ).Where( [ & ]( const User& u ) { return u.mId == e.mUser; } ).Select< std::string >( [ & ]( const User& u ) { return u.mName + std::to_string( e.mValue ); } ).ToVector();
+                    } )
+                    .ToVector();
+
+   auto join = From( events ).Join( users, eventUser, userId, []( const Event& e, const User& u ) { return u.mName + std::to_string( e.mValue ); } );
+   BOOST_TEST_REQUIRE( join.ToVector() == nested );
+
+   auto reversed = From( events ).Take( 50 ).Join( users, eventUser, userId, []( const Event& e, const User& u ) { return u.mName + std::to_string( e.mValue ); } );
+   auto expected = From( events ).Take( 50 ).Join( From( users ).Where( []( const User& ) { return true; } ), eventUser, userId, []( const Event& e, const User& u ) {
+      return u.mName + std::to_string( e.mValue );
+   } );
+   BOOST_TEST_REQUIRE( reversed.ToOrderedVector() == expected.ToOrderedVector() );
+
+   auto groups = From( events ).GroupJoin( users, eventUser, userId, []( const Event& e, const std::vector< User >& m ) { return std::make_pair( e.mUser, m.size() ); } ).ToVector();
+   BOOST_TEST_REQUIRE( groups.size() == events.size() );
+   BOOST_TEST_REQUIRE( From( groups ).All( []( const std::pair< int, size_t >& m ) { return m.second == ( m.first == 7 ? 2u : m.first < 500 ? 1u : 0u ); } ) );
+
+   auto semi = From( events ).SemiJoin( users, eventUser, userId );
+   auto anti = From( events ).AntiJoin( users, eventUser, userId );
+   BOOST_TEST_REQUIRE( semi.Count() == From( events ).Where( []( const Event& m ) { return m.mUser < 500; } ).Count() );
+   BOOST_TEST_REQUIRE( anti.Count() + semi.Count() == events.size() );
+   BOOST_TEST_REQUIRE( anti.All( []( const Event& m ) { return m.mUser >= 500; } ) );
+   BOOST_TEST_REQUIRE( &semi.First() == &events.front() );
+
+   BOOST_TEST_REQUIRE( From( { 1, 2, 3 } ).Join( std::vector< int >{ 2, 3, 3 }, []( int m ) { return m; }, []( int m ) { return m; }, []( int a, int b ) { return a * 10 + b; } ).ToVector() ==
+                       ( std::vector< int >{ 22, 33, 33 } ) );
+}
+
+BOOST_AUTO_TEST_CASE( MergeSorted )
+{
+   std::vector< int > a{ 1, 4, 4, 9, 12 };
+   std::list< int > b{ 2, 4, 5, 20 };
+   std::vector< int > c;
+   std::vector< int > d{ 0, 30 };
+
+   std::vector< int > expected;
+   for( auto& m : { std::vector< int >( a.begin(), a.end() ), std::vector< int >( b.begin(), b.end() ), c, d } )
+   {
+      expected.insert( expected.end(), m.begin(), m.end() );
+   }
+   std::sort( expected.begin(), expected.end() );
+
+   BOOST_TEST_REQUIRE( From( a ).MergeSorted( b, c, d ).ToVector() == expected );
+   BOOST_TEST_REQUIRE( From( a ).MergeSorted( b, c, d ).Count() == expected.size() );
+   BOOST_TEST_REQUIRE( From( a ).MergeSorted().ToVector() == a );
+   BOOST_TEST_REQUIRE( From( c ).MergeSorted( std::vector< int >{ 3, 5 } ).ToVector() == ( std::vector< int >{ 3, 5 } ) );
+
+   std::vector< std::pair< int, int > > left{ { 1, 0 }, { 2, 0 }, { 2, 1 } };
+   std::vector< std::pair< int, int > > right{ { 2, 2 }, { 1, 1 } };
+   auto stable = From( left ).MergeSorted( right ).Select< int >( []( const std::pair< int, int >& m ) { return m.second; } ).ToVector();
+   BOOST_TEST_REQUIRE( stable.size() == 5 );
+
+   std::vector< int > many( 1000 );
+   std::iota( many.begin(), many.end(), 0 );
+   auto odd = From( many ).Where( []( int m ) { return m % 2 != 0; } );
+   auto even = From( many ).Where( []( int m ) { return m % 2 == 0; } ).ToVector();
+   BOOST_TEST_REQUIRE( odd.MergeSorted( even ).ToVector() == many );
+}
+
+BOOST_AUTO_TEST_CASE( MergeJoin )
+{
+   std::vector< std::pair< int, std::string > > outer{ { 1, "a" }, { 2, "b" }, { 2, "c" }, { 4, "d" }, { 7, "e" }, { 9, "f" } };
+   std::vector< std::pair< int, int > > inner{ { 0, 0 }, { 2, 20 }, { 2, 21 }, { 3, 30 }, { 7, 70 }, { 8, 80 } };
+   auto outerKey = []( const std::pair< int, std::string >& m ) { return m.first; };
+   auto innerKey = []( const std::pair< int, int >& m ) { return m.first; };
+   auto result = []( const std::pair< int, std::string >& o, const std::pair< int, int >& i ) { return o.second + std::to_string( i.second ); };
+
+   auto expected = std::vector< std::string >{ "b20", "b21", "c20", "c21", "e70" };
+   BOOST_TEST_REQUIRE( From( outer ).MergeJoin( inner, outerKey, innerKey, result ).ToVector() == expected );
+   BOOST_TEST_REQUIRE( From( outer ).Join( inner, outerKey, innerKey, result ).ToVector() == expected );
+   BOOST_TEST_REQUIRE( From( outer ).MergeJoin( std::vector< std::pair< int, int > >{}, outerKey, innerKey, result ).Count() == 0 );
+
+   std::vector< int > big( 10000 );
+   std::iota( big.begin(), big.end(), 0 );
+   auto squares = From( big ).Select< int >( []( int m ) { return m * m; } ).Where( []( int m ) { return m < 10000; } );
+   auto identity = []( int m ) { return m; };
+   BOOST_TEST_REQUIRE( From( big ).MergeJoin( squares, identity, identity, []( int a, int ) { return a; } ).Count() == 100 );
+}
+
+BOOST_AUTO_TEST_CASE( ExcludeIntersect )
+{
+   int calls = 0;
+   auto counted = From( std::vector< int >{ 2, 4, 6 } ).Select< int >( [ & ]( int m ) {
+      ++calls;
+      return m;
+   } );
+   auto excluded = From( { 1, 2, 3, 4, 5 } ).Exclude( counted );
+   BOOST_TEST_REQUIRE( calls == 0 );
+   auto copy = excluded;
+   BOOST_TEST_REQUIRE( excluded.ToVector() == ( std::vector< int >{ 1, 3, 5 } ) );
+   BOOST_TEST_REQUIRE( copy.ToVector() == ( std::vector< int >{ 1, 3, 5 } ) );
+   BOOST_TEST_REQUIRE( From( { 1, 2, 3, 4, 5 } ).Intersect( counted ).Sum() == 6 );
+   BOOST_TEST_REQUIRE( calls == 6 );
+
+   std::vector< std::string > words{ "alpha", "beta", "gamma" };
+   std::vector< std::string_view > views{ "beta", "delta", "alpha" };
+   BOOST_TEST_REQUIRE( From( views ).Intersect( words ).Count() == 2 );
+   BOOST_TEST_REQUIRE( From( { "delta", "gamma" } ).Exclude( words, []( const char* m ) { return std::string_view( m ); } ).Count() == 1 );
+
+   std::vector< int > large( 200000 );
+   std::iota( large.begin(), large.end(), 0 );
+   auto even = From( large ).Where( []( int m ) { return m % 2 == 0; } ).ToVector();
+   auto odd = From( large ).Exclude( even );
+   BOOST_TEST_REQUIRE( odd.Count() == 100000 );
+   BOOST_TEST_REQUIRE( odd.All( []( int m ) { return m % 2 != 0; } ) );
+   BOOST_TEST_REQUIRE( From( large ).Intersect( even, []( int m ) { return m + 1; } ).Sum() == From( large ).Where( []( int m ) { return m % 2 != 0 && m + 1 < 200000; } ).Sum() );
+   BOOST_TEST_REQUIRE( From( large ).Exclude( std::vector< int >() ).Count() == large.size() );
+}
+
+BOOST_AUTO_TEST_CASE( Index )
+{
+   std::vector< std::pair< int, std::string > > users{ { 3, "c" }, { 1, "a" }, { 2, "b" }, { 1, "aa" } };
+   auto byId = From( users ).ToHashIndex( []( const std::pair< int, std::string >& m ) { return m.first; } );
+   BOOST_TEST_REQUIRE( byId.size() == 4 );
+   BOOST_TEST_REQUIRE( byId.KeyCount() == 3 );
+   BOOST_TEST_REQUIRE( byId.Contains( 2 ) );
+   BOOST_TEST_REQUIRE( !byId.Contains( 4 ) );
+   BOOST_TEST_REQUIRE( byId.Find( 4 ).empty() );
+   BOOST_TEST_REQUIRE( From( byId.Find( 1 ) ).Select< std::string >( []( const std::pair< int, std::string >& m ) { return m.second; } ).ToVector() ==
+                       ( std::vector< std::string >{ "a", "aa" } ) );
+   BOOST_TEST_REQUIRE( From( byId ).Count() == 4 );
+
+   auto ids = From( { 1, 2, 5, 1 } );
+   auto idKey = []( int m ) { return m; };
+   BOOST_TEST_REQUIRE( ids.Join( byId, idKey, []( int, const std::pair< int, std::string >& u ) { return u.second; } ).ToVector() ==
+                       ( std::vector< std::string >{ "a", "aa", "b", "a", "aa" } ) );
+   BOOST_TEST_REQUIRE( ids.GroupJoin( byId, idKey, []( int, const HashIndex< int, std::pair< int, std::string > >::Range& r ) { return r.size(); } ).ToVector() ==
+                       ( std::vector< size_t >{ 2, 1, 0, 2 } ) );
+   BOOST_TEST_REQUIRE( ids.SemiJoin( byId, idKey ).ToVector() == ( std::vector< int >{ 1, 2, 1 } ) );
+   BOOST_TEST_REQUIRE( ids.AntiJoin( byId, idKey ).ToVector() == ( std::vector< int >{ 5 } ) );
+
+   auto blocked = From( { 2, 4, 6 } ).ToHashIndex();
+   BOOST_TEST_REQUIRE( From( { 1, 2, 3, 4 } ).Exclude( blocked ).ToVector() == ( std::vector< int >{ 1, 3 } ) );
+   BOOST_TEST_REQUIRE( From( { 1, 2, 3, 4 } ).Intersect( From( { 4, 2 } ).ToHashIndex() ).ToVector() == ( std::vector< int >{ 2, 4 } ) );
+   BOOST_TEST_REQUIRE( From( { 1, 3 } ).IsIntersect( blocked ) == false );
+   BOOST_TEST_REQUIRE( From( { 1, 6 } ).IsIntersect( blocked ) );
+
+   std::vector< int > large( 100000 );
+   std::iota( large.begin(), large.end(), 0 );
+   auto multiples = From( large ).Select< int >( []( int m ) { return m * 3; } ).ToHashIndex();
+   std::vector< size_t > counts( 4 );
+   std::vector< std::thread > threads;
+   for( size_t t = 0; t < counts.size(); ++t )
+   {
+      threads.emplace_back( [ &, t ] { counts[ t ] = From( large ).Exclude( multiples ).Count(); } );
+   }
+   for( auto& thread : threads )
+   {
+      thread.join();
+   }
+   BOOST_TEST_REQUIRE( From( counts ).All( []( size_t m ) { return m == 66666; } ) );
+
+   auto sorted = From( users ).ToSortedIndex( []( const std::pair< int, std::string >& m ) { return m.first; } );
+   BOOST_TEST_REQUIRE( From( sorted ).Select< std::string >( []( const std::pair< int, std::string >& m ) { return m.second; } ).ToVector() ==
+                       ( std::vector< std::string >{ "a", "aa", "b", "c" } ) );
+   BOOST_TEST_REQUIRE( sorted.Find( 1 ).size() == 2 );
+   BOOST_TEST_REQUIRE( sorted.Between( 2, 4 ).size() == 2 );
+   BOOST_TEST_REQUIRE( sorted.Contains( 3 ) );
+   BOOST_TEST_REQUIRE( !sorted.Contains( 0 ) );
+   BOOST_TEST_REQUIRE( ids.Exclude( sorted, idKey ).ToVector() == ( std::vector< int >{ 5 } ) );
+}
+
+BOOST_AUTO_TEST_CASE( IntersectCount )
+{
+   std::vector< int > a( 1000 );
+   std::iota( a.begin(), a.end(), 0 );
+   std::list< int > b;
+   for( int i = 0; i < 3000; i += 3 )
+   {
+      b.push_back( i );
+   }
+   std::vector< int > tiny{ 999, 5, 5, 1001 };
+
+   BOOST_TEST_REQUIRE( From( a ).IntersectCount( b ) == 334 );
+   BOOST_TEST_REQUIRE( From( b ).IntersectCount( a ) == 334 );
+   BOOST_TEST_REQUIRE( From( a ).IntersectCount( tiny ) == 2 );
+   BOOST_TEST_REQUIRE( From( tiny ).IntersectCount( a ) == 3 );
+   BOOST_TEST_REQUIRE( From( a ).AsSorted().IntersectCount( From( b ).AsSorted() ) == 334 );
+   BOOST_TEST_REQUIRE( From( { 1, 1, 2, 4 } ).AsSorted().IntersectCount( From( { 1, 4, 4 } ).AsSorted() ) == 3 );
+   BOOST_TEST_REQUIRE( From( b ).Where( []( int m ) { return m > 100; } ).IntersectCount( From( a ).Concat( a ) ) == From( b ).Where( []( int m ) { return m > 100; } ).Intersect( From( a ).Concat( a ) ).Count() );
+
+   BOOST_TEST_REQUIRE( From( a ).Overlaps( b, 334 ) );
+   BOOST_TEST_REQUIRE( !From( a ).Overlaps( b, 335 ) );
+   BOOST_TEST_REQUIRE( From( a ).AsSorted().Overlaps( From( tiny ).Skip( 3 ).AsSorted() ) == false );
+   BOOST_TEST_REQUIRE( From( a ).IsIntersect( From( b ).Where( []( int m ) { return m > 990; } ) ) );
+   BOOST_TEST_REQUIRE( !From( a ).IsIntersect( From( b ).Where( []( int m ) { return m > 1000; } ) ) );
+   BOOST_TEST_REQUIRE( !From( a ).IsIntersect( std::vector< int >() ) );
+   BOOST_TEST_REQUIRE( From( a ).AsSorted().Sum() == From( a ).Sum() );
+}
+
+BOOST_AUTO_TEST_CASE( Reentrant )
+{
+   std::vector< int > source( 10000 );
+   for( size_t i = 0; i < source.size(); ++i )
+   {
+      source[ i ] = static_cast< int >( i % 100 );
+   }
+   const auto pipeline = From( source ).Distinct().Skip( 10 ).Take( 50 );
+   BOOST_TEST_REQUIRE( pipeline.Count() == 50 );
+   BOOST_TEST_REQUIRE( pipeline.Sum() == From( source ).Skip( 10 ).Take( 50 ).Sum() );
+
+   std::vector< int > sums( 4 );
+   std::vector< std::thread > threads;
+   for( size_t t = 0; t < sums.size(); ++t )
+   {
+      threads.emplace_back( [ &, t ] {
+         for( int i = 0; i < 20; ++i )
+         {
+            sums[ t ] += pipeline.Sum();
+         }
+      } );
+   }
+   for( auto& thread : threads )
+   {
+      thread.join();
+   }
+   BOOST_TEST_REQUIRE( From( sums ).All( []( int m ) { return m == 20 * 1725; } ) );
+
+   const auto firstTwice = From( { 1, 2, 1, 3, 2, 4 } ).WhereWith( std::vector< int >( 5 ), []( std::vector< int >& seen, int m ) { return ++seen[ m ] == 2; } );
+   BOOST_TEST_REQUIRE( firstTwice.ToVector() == ( std::vector< int >{ 1, 2 } ) );
+   BOOST_TEST_REQUIRE( firstTwice.ToVector() == ( std::vector< int >{ 1, 2 } ) );
+}
+
+BOOST_AUTO_TEST_CASE( DistinctPaths )
+{
+   struct Record
+   {
+      std::string mName;
+      int mId;
+   };
+   std::list< Record > records;
+   for( int i = 0; i < 1000; ++i )
+   {
+      records.push_back( { "name" + std::to_string( i % 37 ), i } );
+   }
+   auto name = []( const Record& m ) -> const std::string& { return m.mName; };
+   auto byName = From( records ).Distinct( name );
+   BOOST_TEST_REQUIRE( byName.Count() == 37 );
+   BOOST_TEST_REQUIRE( byName.Select< int >( []( const Record& m ) { return m.mId; } ).ToVector() == From( records ).Take( 37 ).Select< int >( []( const Record& m ) { return m.mId; } ).ToVector() );
+   BOOST_TEST_REQUIRE( From( records ).Where( []( const Record& m ) { return m.mId % 2 == 0; } ).Distinct( name ).Count() == 37 );
+   BOOST_TEST_REQUIRE( From( records ).Distinct( []( const Record& m ) { return m.mName.size(); } ).Count() == 2 );
+
+   std::vector< int > few{ 3, 1, 3, 2, 1, 1, 3 };
+   BOOST_TEST_REQUIRE( From( few ).Distinct().ToVector() == ( std::vector< int >{ 3, 1, 2 } ) );
+   BOOST_TEST_REQUIRE( From( few ).Select< int >( []( int m ) { return m * 2; } ).Distinct().ToVector() == ( std::vector< int >{ 6, 2, 4 } ) );
+
+   std::vector< int > sorted{ 1, 1, 2, 3, 3, 3, 7, 9, 9 };
+   BOOST_TEST_REQUIRE( From( sorted ).AsSorted().Distinct().ToVector() == ( std::vector< int >{ 1, 2, 3, 7, 9 } ) );
+   BOOST_TEST_REQUIRE( From( sorted ).AsSorted().Distinct().Sum() == 22 );
+
+   std::istringstream stream( "b a b c a d" );
+   BOOST_TEST_REQUIRE( From( std::istream_iterator< std::string >( stream ), std::istream_iterator< std::string >(), 0 ).Distinct().ToVector() ==
+                       ( std::vector< std::string >{ "b", "a", "c", "d" } ) );
+}
+
+BOOST_AUTO_TEST_CASE( Enumerable )
+{
+   std::vector< int > source( 1000 );
+   std::iota( source.begin(), source.end(), 0 );
+   auto erased = From( From( source ).Where( []( int m ) { return m % 3 != 0; } ).Select< int >( []( int m ) { return m * 2; } ).ToEnumerable() );
+   auto expected = From( source ).Where( []( int m ) { return m % 3 != 0; } ).Select< int >( []( int m ) { return m * 2; } ).ToVector();
+
+   BOOST_TEST_REQUIRE( erased.ToVector() == expected );
+   BOOST_TEST_REQUIRE( erased.Count() == expected.size() );
+   BOOST_TEST_REQUIRE( erased.Sum() == From( expected ).Sum() );
+   BOOST_TEST_REQUIRE( erased.Ref().Where( []( int m ) { return m % 4 == 0; } ).ToVector() == From( expected ).Where( []( int m ) { return m % 4 == 0; } ).ToVector() );
+   BOOST_TEST_REQUIRE( erased.Ref().Take( 5 ).Skip( 2 ).ToVector() == ( std::vector< int >{ 8, 10, 14 } ) );
+   BOOST_TEST_REQUIRE( erased.First() == 2 );
+
+   // A stopped ForEach keeps the rest of its batch for the next call, across a move of the iterator.
+   auto iterator = erased.mShim.CreateIterator();
+   std::vector< int > seen;
+   d::ForEach( iterator, [ & ]( int m ) {
+      seen.push_back( m );
+      return seen.size() < 3;
+   } );
+   auto moved = std::move( iterator );
+   seen.push_back( moved.Next().value() );
+   d::ForEach( moved, [ & ]( int m ) {
+      seen.push_back( m );
+      return true;
+   } );
+   BOOST_TEST_REQUIRE( seen == expected );
+
+   std::vector< std::string > strings{ "a", "b", "c" };
+   auto joined = From( From( strings ).Join( strings, []( const std::string& m ) { return m; }, []( const std::string& m ) { return m; }, []( const std::string& a, const std::string& b ) { return a + b; } ).ToEnumerable() );
+   BOOST_TEST_REQUIRE( joined.ToVector() == ( std::vector< std::string >{ "aa", "bb", "cc" } ) );
+   BOOST_TEST_REQUIRE( From( From( strings ).ToEnumerable() ).Aggregate( std::string(), []( std::string a, const std::string& m ) { return a + m; } ) == "abc" );
+}
+
+template< class T >
+struct CountingAllocator
+{
+   using value_type = T;
+
+   size_t* mCount;
+
+   explicit CountingAllocator( size_t* count )
+      : mCount{ count }
+   {
+   }
+
+   template< class U >
+   CountingAllocator( const CountingAllocator< U >& a )
+      : mCount{ a.mCount }
+   {
+   }
+
+   T* allocate( size_t n )
+   {
+      ++*mCount;
+      return std::allocator< T >().allocate( n );
+   }
+
+   void deallocate( T* p, size_t n )
+   {
+      --*mCount;
+      std::allocator< T >().deallocate( p, n );
+   }
+
+   template< class U >
+   bool operator==( const CountingAllocator< U >& a ) const
+   {
+      return mCount == a.mCount;
+   }
+
+   template< class U >
+   bool operator!=( const CountingAllocator< U >& a ) const
+   {
+      return mCount != a.mCount;
+   }
+};
+
+BOOST_AUTO_TEST_CASE( AnyEnumerableValue )
+{
+   std::vector< int > source( 100 );
+   std::iota( source.begin(), source.end(), 0 );
+   auto expected = From( source ).Where( []( int m ) { return m % 3 == 0; } ).ToVector();
+
+   AnyEnumerable query = From( source ).Where( []( int m ) { return m % 3 == 0; } ).Select< int >( []( int m ) { return m; } );
+   BOOST_TEST_REQUIRE( query.Inline() );
+   BOOST_TEST_REQUIRE( From( query ).ToVector() == expected );
+   BOOST_TEST_REQUIRE( From( query ).Where( []( int m ) { return m > 90; } ).ToVector() == ( std::vector< int >{ 93, 96, 99 } ) );
+
+   std::vector< AnyEnumerable< int > > cache;
+   cache.push_back( query );
+   cache.push_back( From( source ).Select< int >( []( int m ) { return -m; } ) );
+   cache.push_back( std::move( query ) );
+   cache = std::vector< AnyEnumerable< int > >( cache );
+   BOOST_TEST_REQUIRE( From( cache[ 0 ] ).ToVector() == expected );
+   BOOST_TEST_REQUIRE( From( cache[ 1 ] ).Sum() == -4950 );
+   BOOST_TEST_REQUIRE( From( cache[ 2 ] ).Count() == expected.size() );
+
+   size_t count = 0;
+   {
+      std::array< int, 32 > offsets{};
+      using Large = AnyEnumerable< int, 16, CountingAllocator< std::byte > >;
+      Large large( From( source ).Select< int >( [ offsets ]( int m ) { return m + offsets[ 0 ]; } ), CountingAllocator< std::byte >( &count ) );
+      BOOST_TEST_REQUIRE( !large.Inline() );
+      BOOST_TEST_REQUIRE( count == 1 );
+      Large copy = large;
+      BOOST_TEST_REQUIRE( count == 2 );
+      Large moved = std::move( large );
+      BOOST_TEST_REQUIRE( count == 2 );
+      copy = moved;
+      BOOST_TEST_REQUIRE( count == 2 );
+      BOOST_TEST_REQUIRE( From( copy ).ToVector() == source );
+   }
+   BOOST_TEST_REQUIRE( count == 0 );
+}
+
+struct CountingResource : std::pmr::memory_resource
+{
+   size_t mAllocations = 0;
+   size_t mBytes = 0;
+
+   void* do_allocate( size_t bytes, size_t alignment ) override
+   {
+      ++mAllocations;
+      mBytes += bytes;
+      return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+   }
+
+   void do_deallocate( void* p, size_t bytes, size_t alignment ) override
+   {
+      mBytes -= bytes;
+      std::pmr::new_delete_resource()->deallocate( p, bytes, alignment );
+   }
+
+   bool do_is_equal( const std::pmr::memory_resource& r ) const noexcept override
+   {
+      return this == &r;
+   }
+};
+
+BOOST_AUTO_TEST_CASE( WithAllocator )
+{
+   std::vector< int > source( 100 );
+   std::iota( source.begin(), source.end(), 0 );
+   std::vector< int > odd = From( source ).Where( []( int m ) { return m % 2 == 1; } ).ToVector();
+
+   static_assert( std::is_same< decltype( From( source ).ToVector() ), std::vector< int > >::value );
+   static_assert( std::is_same< decltype( From( source ).WithAllocator( nullptr ).ToVector() ), std::pmr::vector< int > >::value );
+
+   CountingResource resource;
+   {
+      auto query = From( source ).WithAllocator( &resource ).Select< int >( []( int m ) { return m % 50; } );
+
+      auto vector = query.ToVector();
+      BOOST_TEST_REQUIRE( vector.get_allocator().resource() == &resource );
+      BOOST_TEST_REQUIRE( vector.size() == 100 );
+      auto list = query.ToList();
+      BOOST_TEST_REQUIRE( list.get_allocator().resource() == &resource );
+      BOOST_TEST_REQUIRE( list.size() == 100 );
+      auto deque = query.ToDeque();
+      BOOST_TEST_REQUIRE( deque.get_allocator().resource() == &resource );
+      auto set = query.ToUnorderedSet();
+      BOOST_TEST_REQUIRE( set.get_allocator().resource() == &resource );
+      BOOST_TEST_REQUIRE( set.size() == 50 );
+      auto map = query.ToUnorderedMap< int >( []( int m ) { return m; } );
+      BOOST_TEST_REQUIRE( map.get_allocator().resource() == &resource );
+      BOOST_TEST_REQUIRE( map.size() == 50 );
+
+      auto before = resource.mAllocations;
+      BOOST_TEST_REQUIRE( query.Distinct().ToVector( std::allocator< int >() ).size() == 50 );
+      BOOST_TEST_REQUIRE( resource.mAllocations > before );
+
+      before = resource.mAllocations;
+      auto excluded = From( source ).WithAllocator( &resource ).Exclude( odd ).ToVector( std::allocator< int >() );
+      BOOST_TEST_REQUIRE( excluded.size() == 50 );
+      BOOST_TEST_REQUIRE( resource.mAllocations > before );
+
+      BOOST_TEST_REQUIRE( From( source ).WithAllocator( &resource ).ToOrderedVector( []( int m ) { return -m; } ).front() == 99 );
+      BOOST_TEST_REQUIRE( From( source ).WithAllocator( &resource ).AsParallel().Where( []( int m ) { return m % 2 == 1; } ).ToVector() == From( odd ).ToVector( std::pmr::polymorphic_allocator< int >( &resource ) ) );
+   }
+   BOOST_TEST_REQUIRE( resource.mBytes == 0 );
+
+   std::pmr::monotonic_buffer_resource arena;
+   auto vector = From( source ).ToVector( std::pmr::polymorphic_allocator< std::byte >( &arena ) );
+   BOOST_TEST_REQUIRE( vector.get_allocator().resource() == &arena );
+   BOOST_TEST_REQUIRE( From( source ).ToList( std::pmr::polymorphic_allocator< int >( &arena ) ).size() == 100 );
+   BOOST_TEST_REQUIRE( From( source ).ToVector( 10 ).capacity() >= 10 );
+}
+
+#if defined( __cpp_impl_coroutine )
+Generator< int > Numbers( int n )
+{
+   for( int i = 0; i < n; ++i )
+   {
+      co_yield i;
+   }
+}
+
+Generator< int > Tree( int depth )
+{
+   if( depth != 0 )
+   {
+      co_yield ElementsOf( Tree( depth - 1 ) );
+      co_yield depth;
+      co_yield ElementsOf( Tree( depth - 1 ) );
+   }
+}
+
+Generator< const std::string& > Names()
+{
+   std::string name = "a";
+   co_yield name;
+   name += "b";
+   co_yield name;
+   co_yield std::string( "c" );
+   throw std::runtime_error( "end" );
+}
+
+struct Detached
+{
+   struct promise_type
+   {
+      Detached get_return_object()
+      {
+         return {};
+      }
+
+      std::suspend_never initial_suspend() noexcept
+      {
+         return {};
+      }
+
+      std::suspend_never final_suspend() noexcept
+      {
+         return {};
+      }
+
+      void return_void()
+      {
+      }
+
+      void unhandled_exception()
+      {
+         std::terminate();
+      }
+   };
+};
+
+template< class Q >
+Detached Await( Q query, std::promise< std::vector< int > >& result )
+{
+   result.set_value( co_await query.ToVectorAsync() );
+}
+
+BOOST_AUTO_TEST_CASE( Coroutines )
+{
+   BOOST_TEST_REQUIRE( From( Numbers( 10 ) ).Where( []( int m ) { return m % 3 == 0; } ).ToVector() == ( std::vector< int >{ 0, 3, 6, 9 } ) );
+   BOOST_TEST_REQUIRE( From( Tree( 3 ) ).ToVector() == ( std::vector< int >{ 1, 2, 1, 3, 1, 2, 1 } ) );
+   BOOST_TEST_REQUIRE( From( Numbers( 1000 ) ).Take( 3 ).ToVector() == ( std::vector< int >{ 0, 1, 2 } ) );
+
+   std::vector< std::string > names;
+   BOOST_CHECK_THROW( From( Names() ).Select< std::string >( [ & ]( const std::string& m ) {
+                         names.push_back( m );
+                         return m;
+                      } ).ToVector(),
+                      std::runtime_error );
+   BOOST_TEST_REQUIRE( names == ( std::vector< std::string >{ "a", "ab", "c" } ) );
+
+   Channel< int > channel;
+   std::promise< std::vector< int > > result;
+   auto future = result.get_future();
+   Await( From( channel ).Where( []( int m ) { return m % 2 == 0; } ).AsAsync(), result );
+   for( int i = 0; i < 10; ++i )
+   {
+      channel.Push( i );
+   }
+   channel.Close();
+   BOOST_TEST_REQUIRE( future.get() == ( std::vector< int >{ 0, 2, 4, 6, 8 } ) );
+
+   // The scheduler hands the coroutine back to this thread, as an event loop would.
+   std::mutex mutex;
+   std::condition_variable condition;
+   std::coroutine_handle<> posted;
+   auto post = [ & ]( std::coroutine_handle<> h ) {
+      std::lock_guard< std::mutex > lock( mutex );
+      posted = h;
+      condition.notify_one();
+   };
+   std::promise< std::vector< int > > scheduled;
+   auto scheduledFuture = scheduled.get_future();
+   Await( From( Numbers( 5 ) ).Select< int >( []( int m ) { return m * m; } ).AsAsync( post ), scheduled );
+   {
+      std::unique_lock< std::mutex > lock( mutex );
+      condition.wait( lock, [ & ] { return posted != nullptr; } );
+   }
+   BOOST_TEST_REQUIRE( ( scheduledFuture.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::timeout ) );
+   posted.resume();
+   BOOST_TEST_REQUIRE( scheduledFuture.get() == ( std::vector< int >{ 0, 1, 4, 9, 16 } ) );
+}
+#endif
+
+struct Sample
+{
+   int32_t mId;
+   double mValue;
+};
+
+BOOST_AUTO_TEST_CASE( Files )
+{
+   auto directory = std::filesystem::temp_directory_path();
+   auto lines = directory / "linqcpp_lines.txt";
+   auto records = directory / "linqcpp_records.bin";
+   auto empty = directory / "linqcpp_empty.txt";
+   {
+      std::ofstream( lines, std::ios::binary ) << "first\r\n\nthird\nlast";
+      std::ofstream( empty, std::ios::binary );
+      std::vector< Sample > samples;
+      for( int32_t i = 0; i < 1000; ++i )
+      {
+         samples.push_back( { i, i * 0.5 } );
+      }
+      std::ofstream( records, std::ios::binary ).write( reinterpret_cast< const char* >( samples.data() ), samples.size() * sizeof( Sample ) );
+   }
+
+   BOOST_TEST_REQUIRE( FromFileLines( lines ).Select< std::string >( []( std::string_view m ) { return std::string( m ); } ).ToVector() ==
+                       ( std::vector< std::string >{ "first", "", "third", "last" } ) );
+   BOOST_TEST_REQUIRE( FromFileLines( empty ).Count() == 0 );
+   BOOST_TEST_REQUIRE( FromFileLines( records ).Count() > 0 );
+
+   auto query = FromFileRecords< Sample >( records );
+   BOOST_TEST_REQUIRE( query.Count() == 1000 );
+   BOOST_TEST_REQUIRE( query.GetSizeHint().mExact );
+   BOOST_TEST_REQUIRE( query.Where( []( const Sample& m ) { return m.mId % 2 == 0; } ).Select< double >( []( const Sample& m ) { return m.mValue; } ).Sum() == 124750 );
+   BOOST_TEST_REQUIRE( query.AsParallel().Select< int32_t >( []( const Sample& m ) { return m.mId; } ).Max() == 999 );
+   BOOST_CHECK_THROW( FromFileRecords< Sample >( lines ), std::length_error );
+   BOOST_TEST_REQUIRE( FromFileRecords< Sample >( empty ).Count() == 0 );
+   BOOST_CHECK_THROW( FromFileLines( directory / "linqcpp_missing.txt" ), std::exception );
+
+   d::FileView mapped( records );
+   d::FileView read( records, false );
+   BOOST_TEST_REQUIRE( !read.Mapped() );
+   BOOST_TEST_REQUIRE( ( std::string_view( mapped.Data(), mapped.Size() ) == std::string_view( read.Data(), read.Size() ) ) );
+
+   std::filesystem::remove( lines );
+   std::filesystem::remove( records );
+   std::filesystem::remove( empty );
+}
+
+BOOST_AUTO_TEST_CASE( Split )
+{
+   using Tokens = std::vector< std::string_view >;
+
+   BOOST_TEST_REQUIRE( linq::Split( "a,,bc,", ',' ).ToVector() == ( Tokens{ "a", "", "bc", "" } ) );
+   BOOST_TEST_REQUIRE( linq::Split( "", ',' ).Count() == 0 );
+   BOOST_TEST_REQUIRE( linq::Split( "abc", ',' ).ToVector() == ( Tokens{ "abc" } ) );
+   BOOST_TEST_REQUIRE( linq::Split( "abc", "" ).ToVector() == ( Tokens{ "abc" } ) );
+   BOOST_TEST_REQUIRE( linq::Split( "a\tb,c\t", "\t," ).ToVector() == ( Tokens{ "a", "b", "c", "" } ) );
+
+   // Crosses the 64 byte blocks and the vector widths.
+   std::string buffer;
+   std::vector< std::string > expected;
+   for( size_t i = 0; i < 500; ++i )
+   {
+      expected.push_back( std::string( i % 37, static_cast< char >( 'a' + i % 26 ) ) );
+      buffer += expected.back();
+      buffer += i % 3 == 0 ? ';' : '|';
+   }
+   expected.push_back( "" );
+   BOOST_TEST_REQUIRE( linq::Split( buffer, ";|" ).Select< std::string >( []( std::string_view m ) { return std::string( m ); } ).ToVector() == expected );
+   BOOST_TEST_REQUIRE( linq::Split( buffer, ';' ).Count() == 168 );
+   BOOST_TEST_REQUIRE( linq::Split( std::string_view( buffer ).substr( 1 ), '|' ).Count() == 334 );
+
+   std::vector< std::string > rows{ "1,2,3", "", "4,5" };
+   BOOST_TEST_REQUIRE( From( rows ).SelectMany( ',' ).ToVector() == ( Tokens{ "1", "2", "3", "4", "5" } ) );
+   auto sum = From( rows )
+                 .Select< std::string >( []( const std::string& m ) { return m + ";6"; } )
+                 .SelectMany( ",;" )
+                 .Where( []( std::string_view m ) { return !m.empty(); } )
+                 .Select< int >( []( std::string_view m ) { return std::stoi( std::string( m ) ); } )
+                 .Sum();
+   BOOST_TEST_REQUIRE( sum == 33 );
+}
+
 BOOST_AUTO_TEST_CASE( Const )
 {
    BOOST_TEST_REQUIRE( 0 == 0 );
@@ -1543,10 +2736,10 @@ BOOST_AUTO_TEST_CASE( Const )
 
       std::list< const int* > list = From( container ).ToList();
       std::vector< const int* > vector = From( container ).ToVector();
-      boost::optional< const int* > minOrNone = From( container ).MinOrNone();
-      boost::optional< const int* > maxOrNone = From( container ).MaxOrNone();
-      boost::optional< const int* > lastOrNone = From( container ).LastOrNone();
-      boost::optional< const int* > firstOrNone = From( container ).FirstOrNone();
+      d::optional< const int* > minOrNone = From( container ).MinOrNone();
+      d::optional< const int* > maxOrNone = From( container ).MaxOrNone();
+      d::optional< const int* > lastOrNone = From( container ).LastOrNone();
+      d::optional< const int* > firstOrNone = From( container ).FirstOrNone();
       std::unordered_set< const int* > unorderedSet = From( container ).ToUnorderedSet();
    }
 
@@ -1557,10 +2750,10 @@ BOOST_AUTO_TEST_CASE( Const )
 
       std::list< const int* > list = From( container ).ToList();
       std::vector< const int* > vector = From( container ).ToVector();
-      boost::optional< const int* > minOrNone = From( container ).MinOrNone();
-      boost::optional< const int* > maxOrNone = From( container ).MaxOrNone();
-      boost::optional< const int* > lastOrNone = From( container ).LastOrNone();
-      boost::optional< const int* > firstOrNone = From( container ).FirstOrNone();
+      d::optional< const int* > minOrNone = From( container ).MinOrNone();
+      d::optional< const int* > maxOrNone = From( container ).MaxOrNone();
+      d::optional< const int* > lastOrNone = From( container ).LastOrNone();
+      d::optional< const int* > firstOrNone = From( container ).FirstOrNone();
       std::unordered_set< const int* > unorderedSet = From( container ).ToUnorderedSet();
    }
 
@@ -1571,10 +2764,10 @@ BOOST_AUTO_TEST_CASE( Const )
 
       std::list< int* > list = From( container ).ToList();
       std::vector< int* > vector = From( container ).ToVector();
-      boost::optional< int* > minOrNone = From( container ).MinOrNone();
-      boost::optional< int* > maxOrNone = From( container ).MaxOrNone();
-      boost::optional< int* > lastOrNone = From( container ).LastOrNone();
-      boost::optional< int* > firstOrNone = From( container ).FirstOrNone();
+      d::optional< int* > minOrNone = From( container ).MinOrNone();
+      d::optional< int* > maxOrNone = From( container ).MaxOrNone();
+      d::optional< int* > lastOrNone = From( container ).LastOrNone();
+      d::optional< int* > firstOrNone = From( container ).FirstOrNone();
       std::unordered_set< int* > unorderedSet = From( container ).ToUnorderedSet();
    }
 
@@ -1585,17 +2778,17 @@ BOOST_AUTO_TEST_CASE( Const )
 
       std::list< int* > list = From( container ).ToList();
       std::vector< int* > vector = From( container ).ToVector();
-      boost::optional< int* > minOrNone = From( container ).MinOrNone();
-      boost::optional< int* > maxOrNone = From( container ).MaxOrNone();
-      boost::optional< int* > lastOrNone = From( container ).LastOrNone();
-      boost::optional< int* > firstOrNone = From( container ).FirstOrNone();
+      d::optional< int* > minOrNone = From( container ).MinOrNone();
+      d::optional< int* > maxOrNone = From( container ).MaxOrNone();
+      d::optional< int* > lastOrNone = From( container ).LastOrNone();
+      d::optional< int* > firstOrNone = From( container ).FirstOrNone();
       std::unordered_set< int* > unorderedSet = From( container ).ToUnorderedSet();
    }
 
    {
       const std::vector< int > container;
       std::vector< const int* > vector = From( container ).Select< const int* >( []( const int& m ) { return &m; } ).ToVector();
-      boost::optional< const int*& > firstOrNone = From( vector ).FirstOrNone< const int*& >();
+      d::optional< const int*& > firstOrNone = From( vector ).FirstOrNone< const int*& >();
       ( void )firstOrNone;
    }
 
@@ -1637,6 +2830,44 @@ BOOST_AUTO_TEST_CASE( Optional )
    }
 }
 
+BOOST_AUTO_TEST_CASE( CompactOptional )
+{
+   static_assert( std::is_trivially_copyable< d::Optional< int > >::value );
+   static_assert( std::is_trivially_copyable< d::Optional< int& > >::value );
+   static_assert( sizeof( d::Optional< int& > ) == sizeof( int* ) );
+   static_assert( !std::is_trivially_copyable< d::Optional< std::string > >::value );
+
+   {
+      int i = 1;
+      d::Optional< int& > ref;
+      BOOST_TEST_REQUIRE( !ref );
+      ref = d::Optional< int& >{ i };
+      *ref = 2;
+      BOOST_TEST_REQUIRE( i == 2 );
+      BOOST_TEST_REQUIRE( ref.get_ptr() == &i );
+      ref.reset();
+      BOOST_TEST_REQUIRE( !ref.is_initialized() );
+   }
+
+   {
+      d::Optional< std::string > str{ std::string( "text" ) };
+      d::Optional< std::string > copy = str;
+      BOOST_TEST_REQUIRE( copy.value() == "text" );
+      d::Optional< std::string > moved = std::move( str );
+      BOOST_TEST_REQUIRE( moved.value() == "text" );
+      moved.reset();
+      BOOST_TEST_REQUIRE( moved.value_or( "none" ) == "none" );
+      BOOST_CHECK_THROW( moved.value(), d::BadOptionalAccess );
+   }
+
+   {
+      std::vector< std::string > vector{ "1", "2" };
+      d::optional< std::string& > first = From( vector ).FirstOrNone< std::string& >();
+      BOOST_TEST_REQUIRE( &first.value() == &vector.front() );
+      BOOST_TEST_REQUIRE( From( vector ).Select< std::string >( []( const std::string& m ) { return m + m; } ).LastOrNone().value() == "22" );
+   }
+}
+
 BOOST_AUTO_TEST_CASE( Array )
 {
    {
@@ -1796,7 +3027,7 @@ BOOST_AUTO_TEST_CASE( FromFn )
          .Skip( 5 )
          .Take( 1 )
          .ToVector();
-      BOOST_TEST_REQUIRE( i == 2 ); // in future should be i == 1
+      BOOST_TEST_REQUIRE( i == 1 );
    }
 }
 